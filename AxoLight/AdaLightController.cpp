@@ -1,35 +1,16 @@
 #include "pch.h"
 #include "AdaLightController.h"
+#include "Tracing.h"
 
 using namespace std;
 using namespace std::chrono;
 
 using namespace winrt;
-using namespace winrt::Windows::Devices::Enumeration;
-using namespace winrt::Windows::Devices::SerialCommunication;
-using namespace winrt::Windows::Storage::Streams;
+
+using namespace AxoLight::Infrastructure;
 
 namespace AxoLight::Lighting
 {
-  AdaLightController::AdaLightController(const AdaLightOptions& options)
-  {
-    auto deviceSelector = SerialDevice::GetDeviceSelectorFromUsbVidPid(options.UsbVendorId, options.UsbProductId);
-    auto deviceInformations = DeviceInformation::FindAllAsync(deviceSelector).get();
-    if (deviceInformations.Size() == 0) return;
-
-    auto deviceInformation = deviceInformations.GetAt(0);
-    auto serialDevice = SerialDevice::FromIdAsync(deviceInformation.Id()).get();
-    serialDevice.BaudRate(options.BaudRate);
-    _serialWriter = DataWriter(serialDevice.OutputStream());
-
-    _ledSyncDuration = options.LedSyncDuration;
-  }
-
-  bool AdaLightController::IsConnected()
-  {
-    return _serialWriter != nullptr;
-  }
-
   std::array<uint8_t, 256> _gamma8 = {
     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  1,  1,  1,  1,
@@ -48,48 +29,190 @@ namespace AxoLight::Lighting
   177,180,182,184,186,189,191,193,196,198,200,203,205,208,210,213,
   215,218,220,223,225,228,231,233,236,239,241,244,247,249,252,255 };
 
-  void AdaLightController::Push(const std::vector<Colors::rgb>& colors)
+  AdaLightController::AdaLightController(const AdaLightOptions& options) :
+    _encoder(_gamma8, options.CalibrationPath)
   {
-    if (!_serialWriter) throw hresult_illegal_method_call(L"Cannot push colors if no device is connected");
+    auto transport = serial_transport::create(options);
+    if (!transport->is_open()) return;
 
-    auto now = steady_clock::now();
-    auto timeSyncLastUpdate = now - _lastUpdate;
-    if (timeSyncLastUpdate < _ledSyncDuration)
+    _transport = move(transport);
+
+    _latchMargin = options.LatchMargin;
+
+    _isRunning = true;
+    _writerThread = thread([this] { Write(); });
+  }
+
+  AdaLightController::~AdaLightController()
+  {
+    _isRunning = false;
+    if (_writerThread.joinable()) _writerThread.join();
+  }
+
+  bool AdaLightController::IsConnected()
+  {
+    return _transport != nullptr;
+  }
+
+  void AdaLightController::Push(const std::vector<Colors::rgb>& colors, std::chrono::steady_clock::time_point captureTime, std::chrono::steady_clock::time_point latchTime)
+  {
+    if (!_transport) throw hresult_illegal_method_call(L"Cannot push colors if no device is connected");
+
+    auto& message = _messages.back();
+    _encoder.encode(colors, message.bytes);
+    message.capture_time = captureTime;
+    message.latch_time = latchTime;
+
+    _pushedFrames++;
+    if (!_messages.publish()) _coalescedFrames++;
+  }
+
+  AdaLightStatistics AdaLightController::GetStatistics() const
+  {
+    return { _pushedFrames, _writtenFrames, _coalescedFrames, _droppedFrames };
+  }
+
+  AdaLightLatencies AdaLightController::GetLatencies() const
+  {
+    return { _writeLatency.snapshot(), _captureToWireLatency.snapshot(), _latchSkew.snapshot() };
+  }
+
+  std::chrono::steady_clock::duration AdaLightController::GetWireTime(size_t size, uint32_t baudRate)
+  {
+    //Each byte is framed by a start and a stop bit
+    return duration_cast<steady_clock::duration>(duration<double>(size * 10.0 / baudRate));
+  }
+
+  std::chrono::steady_clock::duration AdaLightController::GetFrameWireTime(size_t lightCount) const
+  {
+    return _transport ? _transport->wire_time(adalight_encoder::header_size + lightCount * 3) : steady_clock::duration::zero();
+  }
+
+  std::chrono::steady_clock::time_point AdaLightController::GetNextWriteTime() const
+  {
+    return _nextWrite;
+  }
+
+  void AdaLightController::Write()
+  {
+    trace_buffer::name_thread("serial writer");
+
+    while (_isRunning)
     {
-      this_thread::sleep_for(_ledSyncDuration - timeSyncLastUpdate);
-      _lastUpdate = steady_clock::now();
+      if (!_messages.wait_update(100u)) continue;
+
+      //The next frame may only start once the previous one is on the wire and the LEDs had time to latch it, and not before its latch time allows
+      auto now = steady_clock::now();
+      while (true)
+      {
+        auto& message = _messages.front();
+        steady_clock::time_point start = _nextWrite;
+        if (message.latch_time != steady_clock::time_point()) start = max(start, message.latch_time - _transport->wire_time(message.bytes.size()));
+        if (now >= start) break;
+
+        this_thread::sleep_until(start);
+        now = steady_clock::now();
+
+        //A frame pushed while waiting supersedes the current one
+        if (_messages.update()) _coalescedFrames++;
+      }
+
+      auto& message = _messages.front();
+      _nextWrite = now + _transport->wire_time(message.bytes.size()) + _latchMargin;
+      _transport->write(message.bytes.data(), message.bytes.size());
+      auto isWritten = _transport->wait();
+
+      auto writtenTime = steady_clock::now();
+      _writeLatency.record(writtenTime - now);
+      trace_buffer::record("write", now, writtenTime);
+      if (!isWritten)
+      {
+        _droppedFrames++;
+        continue;
+      }
+
+      _writtenFrames++;
+
+      if (message.latch_time != steady_clock::time_point())
+      {
+        _latchSkew.record(writtenTime > message.latch_time ? writtenTime - message.latch_time : message.latch_time - writtenTime);
+      }
+
+      //Frames pushed without a new capture only fade the lights, they are not counted again
+      if (message.capture_time != steady_clock::time_point() && message.capture_time != _lastCaptureTime)
+      {
+        _captureToWireLatency.record(writtenTime - message.capture_time);
+        _lastCaptureTime = message.capture_time;
+      }
     }
-    else
+  }
+
+  AdaLightControllerGroup::AdaLightControllerGroup(const std::vector<AdaLightOptions>& options, size_t lightCount)
+  {
+    size_t offset = 0u;
+    for (auto& controllerOptions : options)
     {
-      _lastUpdate = now;
+      auto count = controllerOptions.LightCount > 0 ? size_t(controllerOptions.LightCount) : lightCount - offset;
+      if (offset + count > lightCount) throw hresult_invalid_argument(L"The controllers drive more lights than the layout has.");
+      if (count == 0u) throw hresult_invalid_argument(L"A controller has no lights left to drive.");
+
+      segment item;
+      item.controller = make_unique<AdaLightController>(controllerOptions);
+      item.offset = offset;
+      item.count = count;
+      item.wire_time = item.controller->GetFrameWireTime(count);
+      item.colors.resize(count);
+      _segments.push_back(move(item));
+
+      offset += count;
     }
 
-    auto length = 6 + colors.size() * 3;
+    if (offset != lightCount) throw hresult_invalid_argument(L"The controllers drive fewer lights than the layout has.");
+  }
 
-    vector<uint8_t> messsage;
-    messsage.reserve(length);
+  bool AdaLightControllerGroup::IsConnected()
+  {
+    return !_segments.empty() && all_of(_segments.begin(), _segments.end(), [](segment& item) { return item.controller->IsConnected(); });
+  }
 
-    messsage.push_back(0x41);
-    messsage.push_back(0x64);
-    messsage.push_back(0x61);
+  void AdaLightControllerGroup::Push(const std::vector<Colors::rgb>& colors, std::chrono::steady_clock::time_point captureTime)
+  {
+    //The strips latch when the last of them can have its frame on the wire, including any still sending the previous frame
+    auto now = steady_clock::now();
+    auto latchTime = now;
+    for (auto& segment : _segments)
+    {
+      latchTime = max(latchTime, max(now, segment.controller->GetNextWriteTime()) + segment.wire_time);
+    }
 
-    auto adjustedLedCount = colors.size() - 1;
-    auto highCount = (uint8_t)(adjustedLedCount >> 8);
-    auto lowCount = (uint8_t)(adjustedLedCount & 0xff);
-    auto checksumCount = (uint8_t)(highCount ^ lowCount ^ 0x55);
-    
-    messsage.push_back(highCount);
-    messsage.push_back(lowCount);
-    messsage.push_back(checksumCount);
+    for (auto& segment : _segments)
+    {
+      copy(colors.begin() + segment.offset, colors.begin() + segment.offset + segment.count, segment.colors.begin());
+      segment.controller->Push(segment.colors, captureTime, latchTime);
+    }
+  }
 
-    for (auto& color : colors)
+  AdaLightStatistics AdaLightControllerGroup::GetStatistics() const
+  {
+    AdaLightStatistics result{};
+    for (auto& segment : _segments)
     {
-      messsage.push_back(_gamma8[color.r]);
-      messsage.push_back(_gamma8[color.g]);      
-      messsage.push_back(_gamma8[color.b]);
+      auto statistics = segment.controller->GetStatistics();
+      result.PushedFrames += statistics.PushedFrames;
+      result.WrittenFrames += statistics.WrittenFrames;
+      result.CoalescedFrames += statistics.CoalescedFrames;
+      result.DroppedFrames += statistics.DroppedFrames;
     }
+    return result;
+  }
 
-    _serialWriter.WriteBytes(messsage);
-    _serialWriter.StoreAsync().get();
+  size_t AdaLightControllerGroup::GetControllerCount() const
+  {
+    return _segments.size();
+  }
+
+  const AdaLightController& AdaLightControllerGroup::GetController(size_t index) const
+  {
+    return *_segments[index].controller;
   }
 }
\ No newline at end of file
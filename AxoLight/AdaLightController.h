@@ -1,27 +1,138 @@
 #pragma once
 #include "Colors.h"
+#include "AdaLightEncoder.h"
+#include "Threading.h"
+#include "Metrics.h"
+#include "SerialTransports.h"
 
 namespace AxoLight::Lighting
 {
   struct AdaLightOptions
   {
+    SerialTransportType Transport = SerialTransportType::UsbDevice;
+    std::wstring PortName;
     uint16_t UsbVendorId = 0x1A86;
     uint16_t UsbProductId = 0x7523;
+    uint32_t DeviceIndex = 0;
     uint32_t BaudRate = 1000000;
-    std::chrono::milliseconds LedSyncDuration = std::chrono::milliseconds(7);
+    std::chrono::microseconds LatchMargin = std::chrono::microseconds(2500);
+    std::filesystem::path CalibrationPath;
+
+    //Ddp and E131, a port of zero uses the default one of the protocol
+    std::wstring Address;
+    uint16_t NetworkPort = 0;
+    uint16_t Universe = 1;
+
+    //Number of lights driven by this controller when a layout is split over several, zero takes all remaining ones
+    uint16_t LightCount = 0;
+  };
+
+  struct AdaLightStatistics
+  {
+    uint64_t PushedFrames;
+    uint64_t WrittenFrames;
+    uint64_t CoalescedFrames;
+    uint64_t DroppedFrames;
+  };
+
+  struct AdaLightLatencies
+  {
+    //Time from starting a write until the transport completed it
+    Infrastructure::latency_snapshot Write;
+
+    //Time from capturing a frame until its colors were first written
+    Infrastructure::latency_snapshot CaptureToWire;
+
+    //Distance of the end of each write from its requested latch time
+    Infrastructure::latency_snapshot LatchSkew;
   };
 
   class AdaLightController
   {
   public:
     AdaLightController(const AdaLightOptions& options = {});
+    ~AdaLightController();
+
+    AdaLightController(const AdaLightController&) = delete;
+    AdaLightController& operator=(const AdaLightController&) = delete;
 
     bool IsConnected();
-    void Push(const std::vector<Colors::rgb>& colors);
+
+    //Encodes the colors and queues them for writing without waiting, a frame still waiting to be written is replaced. Must be called from a single thread.
+    //With a latch time the write is delayed so its last byte arrives at that time.
+    void Push(const std::vector<Colors::rgb>& colors, std::chrono::steady_clock::time_point captureTime = {}, std::chrono::steady_clock::time_point latchTime = {});
+
+    AdaLightStatistics GetStatistics() const;
+
+    AdaLightLatencies GetLatencies() const;
+
+    //Time needed to send the given number of bytes over an 8N1 serial line
+    static std::chrono::steady_clock::duration GetWireTime(size_t size, uint32_t baudRate);
+
+    //Time the transport needs to carry a frame of the given number of lights
+    std::chrono::steady_clock::duration GetFrameWireTime(size_t lightCount) const;
+
+    //Earliest time the next frame can start on the wire, once the previous one is out and latched
+    std::chrono::steady_clock::time_point GetNextWriteTime() const;
 
   private:
-    winrt::Windows::Storage::Streams::DataWriter _serialWriter = nullptr;
-    std::chrono::steady_clock::duration _ledSyncDuration;
-    std::chrono::steady_clock::time_point _lastUpdate;
+    struct message
+    {
+      std::vector<uint8_t> bytes;
+      std::chrono::steady_clock::time_point capture_time;
+      std::chrono::steady_clock::time_point latch_time;
+    };
+
+    adalight_encoder _encoder;
+    std::unique_ptr<serial_transport> _transport;
+    std::chrono::steady_clock::duration _latchMargin;
+    std::atomic<std::chrono::steady_clock::time_point> _nextWrite = std::chrono::steady_clock::time_point();
+
+    Infrastructure::triple_buffer<message> _messages;
+    std::atomic<bool> _isRunning = false;
+    std::thread _writerThread;
+
+    std::atomic<uint64_t> _pushedFrames = 0u;
+    std::atomic<uint64_t> _writtenFrames = 0u;
+    std::atomic<uint64_t> _coalescedFrames = 0u;
+    std::atomic<uint64_t> _droppedFrames = 0u;
+
+    Infrastructure::latency_histogram _writeLatency;
+    Infrastructure::latency_histogram _captureToWireLatency;
+    Infrastructure::latency_histogram _latchSkew;
+    std::chrono::steady_clock::time_point _lastCaptureTime;
+
+    void Write();
+  };
+
+  //Drives one layout through several controllers on separate ports, each takes the next range of lights and all of them latch at the same time.
+  //Every controller must get at least one light and together they must cover the layout, otherwise hresult_invalid_argument is thrown.
+  class AdaLightControllerGroup
+  {
+  public:
+    AdaLightControllerGroup(const std::vector<AdaLightOptions>& options, size_t lightCount);
+
+    //True if every controller is connected
+    bool IsConnected();
+
+    //Splits the colors over the controllers, the write of the longest range starts right away and the others are delayed to finish with it
+    void Push(const std::vector<Colors::rgb>& colors, std::chrono::steady_clock::time_point captureTime = {});
+
+    AdaLightStatistics GetStatistics() const;
+
+    size_t GetControllerCount() const;
+
+    const AdaLightController& GetController(size_t index) const;
+
+  private:
+    struct segment
+    {
+      std::unique_ptr<AdaLightController> controller;
+      size_t offset, count;
+      std::chrono::steady_clock::duration wire_time;
+      std::vector<Colors::rgb> colors;
+    };
+
+    std::vector<segment> _segments;
   };
 }
\ No newline at end of file
@@ -0,0 +1,37 @@
+#include "pch.h"
+#include "AdaLightEncoder.h"
+
+using namespace AxoLight::Colors;
+
+using namespace std;
+
+namespace AxoLight::Lighting
+{
+  adalight_encoder::adalight_encoder(const std::array<uint8_t, 256>& gamma, const std::filesystem::path& calibrationPath) :
+    _calibration(gamma, calibrationPath)
+  { }
+
+  void adalight_encoder::encode(const std::vector<Colors::rgb>& colors, std::vector<uint8_t>& frame)
+  {
+    auto length = header_size + colors.size() * 3;
+    if (frame.size() != length)
+    {
+      frame.resize(length);
+
+      frame[0] = 0x41;
+      frame[1] = 0x64;
+      frame[2] = 0x61;
+
+      auto adjustedLedCount = colors.size() - 1;
+      auto highCount = (uint8_t)(adjustedLedCount >> 8);
+      auto lowCount = (uint8_t)(adjustedLedCount & 0xff);
+      auto checksumCount = (uint8_t)(highCount ^ lowCount ^ 0x55);
+
+      frame[3] = highCount;
+      frame[4] = lowCount;
+      frame[5] = checksumCount;
+    }
+
+    _calibration.apply(colors.data(), colors.size(), frame.data() + header_size, lightness_factor(colors));
+  }
+}
\ No newline at end of file
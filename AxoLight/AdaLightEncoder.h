@@ -0,0 +1,21 @@
+#pragma once
+#include "pch.h"
+#include "CalibrationLut.h"
+
+namespace AxoLight::Lighting
+{
+  //Writes complete Adalight frames, the lightness limit, calibration and gamma are applied in a single pass over the colors
+  struct adalight_encoder
+  {
+  private:
+    Colors::calibration_lut _calibration;
+
+  public:
+    static const size_t header_size = 6u;
+
+    adalight_encoder(const std::array<uint8_t, 256>& gamma, const std::filesystem::path& calibrationPath = {});
+
+    //The frame is reused between calls, its header is only rewritten when the light count changes
+    void encode(const std::vector<Colors::rgb>& colors, std::vector<uint8_t>& frame);
+  };
+}
\ No newline at end of file
@@ -0,0 +1,197 @@
+#include "pch.h"
+#include "CalibrationLut.h"
+#include "Simd.h"
+
+using namespace AxoLight::Simd;
+
+using namespace std;
+using namespace winrt;
+
+namespace AxoLight::Colors
+{
+  static_assert(sizeof(rgb) == 3, "Colors are read and looked up as a flat channel array.");
+
+  const uint32_t max_lattice_size = 256u;
+
+  //Lattice entries are packed as 0x00bbggrr
+  uint32_t pack(const rgb& color)
+  {
+    return color.r | (color.g << 8) | (color.b << 16);
+  }
+
+  void lookup_bytes(const uint8_t* table, const uint8_t* source, size_t count, uint8_t* target)
+  {
+    for (size_t i = 0u; i < count; i++)
+    {
+      target[i] = table[source[i]];
+    }
+  }
+
+  //Two VPERMB lookups cover the lower and upper half of the table, the top bit of the index picks between them
+  void lookup_bytes_avx512_vbmi(const uint8_t* table, const uint8_t* source, size_t count, uint8_t* target)
+  {
+    auto table0 = _mm512_loadu_si512(table);
+    auto table1 = _mm512_loadu_si512(table + 64);
+    auto table2 = _mm512_loadu_si512(table + 128);
+    auto table3 = _mm512_loadu_si512(table + 192);
+
+    for (size_t i = 0u; i < count; i += 64u)
+    {
+      auto mask = count - i >= 64u ? ~__mmask64(0) : (__mmask64(1) << (count - i)) - 1u;
+      auto index = _mm512_maskz_loadu_epi8(mask, source + i);
+
+      auto low = _mm512_permutex2var_epi8(table0, index, table1);
+      auto high = _mm512_permutex2var_epi8(table2, index, table3);
+      auto result = _mm512_mask_blend_epi8(_mm512_movepi8_mask(index), low, high);
+
+      _mm512_mask_storeu_epi8(target + i, mask, result);
+    }
+  }
+
+  void apply_calibration(const uint32_t* lattice, uint32_t size, const uint32_t* gamma, const uint8_t* levels, const rgb* colors, size_t count, uint8_t* target)
+  {
+    auto scale = float(size - 1) / 255.f;
+    auto maxCell = float(size - 2);
+
+    for (size_t i = 0u; i < count; i++)
+    {
+      auto& color = colors[i];
+      auto pr = levels[color.r] * scale, pg = levels[color.g] * scale, pb = levels[color.b] * scale;
+      auto cr = min(float(int32_t(pr)), maxCell), cg = min(float(int32_t(pg)), maxCell), cb = min(float(int32_t(pb)), maxCell);
+      auto fr = pr - cr, fg = pg - cg, fb = pb - cb;
+      auto base = int32_t((cr * size + cg) * size + cb);
+
+      float r = 0.f, g = 0.f, b = 0.f;
+      for (auto corner = 0u; corner < 8u; corner++)
+      {
+        auto dr = corner >> 2, dg = (corner >> 1) & 1u, db = corner & 1u;
+        auto weight = (dr ? fr : 1.f - fr) * (dg ? fg : 1.f - fg) * (db ? fb : 1.f - fb);
+        auto entry = lattice[base + int32_t((dr * size + dg) * size + db)];
+
+        r = r + float(entry & 0xff) * weight;
+        g = g + float((entry >> 8) & 0xff) * weight;
+        b = b + float(entry >> 16) * weight;
+      }
+
+      *target++ = uint8_t(gamma[int32_t(r + 0.5f)]);
+      *target++ = uint8_t(gamma[int32_t(g + 0.5f)]);
+      *target++ = uint8_t(gamma[int32_t(b + 0.5f)]);
+    }
+  }
+
+  //Same as apply_calibration, one light per lane
+  template<typename TFloat>
+  void apply_calibration_simd(const uint32_t* lattice, uint32_t size, const uint32_t* gamma, const uint8_t* levels, const rgb* colors, size_t count, uint8_t* target)
+  {
+    typedef typename TFloat::int_t TInt;
+
+    auto scale = TFloat(float(size - 1) / 255.f);
+    auto maxCell = TFloat(float(size - 2));
+    auto floatSize = TFloat(float(size));
+    auto one = TFloat(1.f);
+    auto half = TFloat(0.5f);
+    auto mask = TInt(0xff);
+
+    array<int32_t, TFloat::width> r, g, b;
+    for (size_t i = 0u; i < count; i += TFloat::width)
+    {
+      for (size_t j = 0u; j < TFloat::width; j++)
+      {
+        r[j] = levels[colors[i + j].r];
+        g[j] = levels[colors[i + j].g];
+        b[j] = levels[colors[i + j].b];
+      }
+
+      auto pr = to_float(TInt::load(r.data())) * scale, pg = to_float(TInt::load(g.data())) * scale, pb = to_float(TInt::load(b.data())) * scale;
+      auto cr = min(to_float(to_int(pr)), maxCell), cg = min(to_float(to_int(pg)), maxCell), cb = min(to_float(to_int(pb)), maxCell);
+      auto fr = pr - cr, fg = pg - cg, fb = pb - cb;
+      auto base = to_int((cr * floatSize + cg) * floatSize + cb);
+
+      TFloat sumR(0.f), sumG(0.f), sumB(0.f);
+      for (auto corner = 0u; corner < 8u; corner++)
+      {
+        auto dr = corner >> 2, dg = (corner >> 1) & 1u, db = corner & 1u;
+        auto weight = (dr ? fr : one - fr) * (dg ? fg : one - fg) * (db ? fb : one - fb);
+        auto entry = TInt::gather(lattice, base + TInt(int32_t((dr * size + dg) * size + db)));
+
+        sumR = sumR + to_float(entry & mask) * weight;
+        sumG = sumG + to_float((entry >> 8) & mask) * weight;
+        sumB = sumB + to_float(entry >> 16) * weight;
+      }
+
+      TInt::gather(gamma, to_int(sumR + half)).store(r.data());
+      TInt::gather(gamma, to_int(sumG + half)).store(g.data());
+      TInt::gather(gamma, to_int(sumB + half)).store(b.data());
+
+      for (size_t j = 0u; j < TFloat::width; j++)
+      {
+        *target++ = uint8_t(r[j]);
+        *target++ = uint8_t(g[j]);
+        *target++ = uint8_t(b[j]);
+      }
+    }
+  }
+
+  calibration_lut::calibration_lut(const std::array<uint8_t, 256>& gamma, const std::filesystem::path& path) :
+    _useAvx2(has_avx2()),
+    _useAvx512Vbmi(has_avx512_vbmi())
+  {
+    copy(gamma.begin(), gamma.end(), _gamma.begin());
+    copy(gamma.begin(), gamma.end(), _levels.begin());
+    if (path.empty()) return;
+
+    FILE* file = nullptr;
+    _wfopen_s(&file, path.c_str(), L"rb");
+    if (!file) throw hresult_invalid_argument(L"Cannot open calibration file.");
+
+    calibration_lut_header header{};
+    vector<rgb> points;
+    auto isValid = fread(&header, sizeof(header), 1, file) == 1 &&
+      header.magic == calibration_lut_header::magic_value && header.size >= 2u && header.size <= max_lattice_size;
+    if (isValid)
+    {
+      points.resize(size_t(header.size) * header.size * header.size);
+      isValid = fread(points.data(), sizeof(rgb), points.size(), file) == points.size();
+    }
+    fclose(file);
+
+    if (!isValid) throw hresult_invalid_argument(L"The calibration file is invalid.");
+
+    _size = header.size;
+    _lattice.resize(points.size());
+    transform(points.begin(), points.end(), _lattice.begin(), pack);
+
+    iota(_levels.begin(), _levels.end(), uint8_t(0));
+  }
+
+  void calibration_lut::update_levels(float scale)
+  {
+    _scale = scale;
+    for (auto i = 0u; i < 256u; i++)
+    {
+      auto level = uint8_t(i * scale);
+      _levels[i] = is_calibrated() ? level : uint8_t(_gamma[level]);
+    }
+  }
+
+  bool calibration_lut::is_calibrated() const
+  {
+    return _size > 0u;
+  }
+
+  void calibration_lut::apply(const rgb* colors, size_t count, uint8_t* target, float scale)
+  {
+    if (scale != _scale) update_levels(scale);
+
+    //Without calibration every channel goes through the same table, so the colors are looked up as a flat byte array
+    if (!is_calibrated())
+    {
+      (_useAvx512Vbmi ? lookup_bytes_avx512_vbmi : lookup_bytes)(_levels.data(), (const uint8_t*)colors, count * 3, target);
+      return;
+    }
+
+    auto vectorSize = count / (_useAvx2 ? 8 : 4) * (_useAvx2 ? 8 : 4);
+    (_useAvx2 ? apply_calibration_simd<float_x8> : apply_calibration_simd<float_x4>)(_lattice.data(), _size, _gamma.data(), _levels.data(), colors, vectorSize, target);
+    apply_calibration(_lattice.data(), _size, _gamma.data(), _levels.data(), colors + vectorSize, count - vectorSize, target + vectorSize * 3);
+  }
+}
\ No newline at end of file
@@ -0,0 +1,42 @@
+#pragma once
+#include "pch.h"
+#include "Colors.h"
+
+namespace AxoLight::Colors
+{
+  //Calibration files: a calibration_lut_header followed by size^3 LED colors as rgb bytes, red changing slowest and blue fastest.
+  //Lattice point i of each axis sits at color level i * 255 / (size - 1).
+  struct calibration_lut_header
+  {
+    static const uint32_t magic_value = 0x4c435841; //AXCL
+
+    uint32_t magic;
+    uint32_t size;
+  };
+
+  //Turns light colors into the bytes sent to the LEDs in a single pass: the calibration lattice is interpolated trilinearly, then the gamma table is applied
+  struct calibration_lut
+  {
+  private:
+    uint32_t _size = 0u;
+    std::vector<uint32_t> _lattice;
+    std::array<uint32_t, 256> _gamma;
+    bool _useAvx2;
+    bool _useAvx512Vbmi;
+
+    //Per level tables for the current scale, the gamma is included if there is no calibration
+    float _scale = 1.f;
+    std::array<uint8_t, 256> _levels;
+
+    void update_levels(float scale);
+
+  public:
+    //Without a calibration file only the gamma table is applied
+    calibration_lut(const std::array<uint8_t, 256>& gamma, const std::filesystem::path& path = {});
+
+    bool is_calibrated() const;
+
+    //Writes count rgb triplets to the target, the colors are multiplied by scale first
+    void apply(const rgb* colors, size_t count, uint8_t* target, float scale = 1.f);
+  };
+}
\ No newline at end of file
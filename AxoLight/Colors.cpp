@@ -1,5 +1,8 @@
 #include "pch.h"
 #include "Colors.h"
+#include "SimdColors.h"
+
+using namespace AxoLight::Simd;
 
 using namespace std;
 using namespace winrt::Windows::Foundation::Numerics;
@@ -95,6 +98,95 @@ namespace AxoLight::Colors
     };
   }
 
+  void rgb_buffer::resize(size_t size)
+  {
+    r.resize(size);
+    g.resize(size);
+    b.resize(size);
+  }
+
+  void hsl_buffer::resize(size_t size)
+  {
+    h.resize(size);
+    s.resize(size);
+    l.resize(size);
+  }
+
+  template<typename TFloat>
+  void rgb_to_hsl_simd(const rgb_buffer& rgb, hsl_buffer& hsl, size_t count)
+  {
+    typedef typename TFloat::int_t TInt;
+
+    for (size_t i = 0u; i < count; i += TFloat::width)
+    {
+      auto r = to_float(TInt::load_bytes(rgb.r.data() + i)) * TFloat(1.f / 255.f);
+      auto g = to_float(TInt::load_bytes(rgb.g.data() + i)) * TFloat(1.f / 255.f);
+      auto b = to_float(TInt::load_bytes(rgb.b.data() + i)) * TFloat(1.f / 255.f);
+
+      TFloat h, s, l;
+      rgb_to_hsl(r, g, b, h, s, l);
+
+      h.store(hsl.h.data() + i);
+      s.store(hsl.s.data() + i);
+      l.store(hsl.l.data() + i);
+    }
+  }
+
+  template<typename TFloat>
+  void hsl_to_rgb_simd(const hsl_buffer& hsl, rgb_buffer& rgb, size_t count)
+  {
+    for (size_t i = 0u; i < count; i += TFloat::width)
+    {
+      auto h = TFloat::load(hsl.h.data() + i);
+      auto s = TFloat::load(hsl.s.data() + i);
+      auto l = TFloat::load(hsl.l.data() + i);
+
+      TFloat r, g, b;
+      hsl_to_rgb(h, s, l, r, g, b);
+
+      to_int(r * TFloat(255.f)).store_bytes(rgb.r.data() + i);
+      to_int(g * TFloat(255.f)).store_bytes(rgb.g.data() + i);
+      to_int(b * TFloat(255.f)).store_bytes(rgb.b.data() + i);
+    }
+  }
+
+  void rgb_to_hsl(const rgb_buffer& rgb, hsl_buffer& hsl)
+  {
+    auto size = rgb.size();
+    hsl.resize(size);
+
+    //The vector kernels cover whole lane groups, the rest is converted one by one
+    auto useAvx2 = has_avx2();
+    auto vectorSize = size / (useAvx2 ? 8 : 4) * (useAvx2 ? 8 : 4);
+    (useAvx2 ? rgb_to_hsl_simd<float_x8> : rgb_to_hsl_simd<float_x4>)(rgb, hsl, vectorSize);
+
+    for (auto i = vectorSize; i < size; i++)
+    {
+      auto result = rgb_to_hsl(Colors::rgb{ rgb.r[i], rgb.g[i], rgb.b[i] });
+      hsl.h[i] = result.h;
+      hsl.s[i] = result.s;
+      hsl.l[i] = result.l;
+    }
+  }
+
+  void hsl_to_rgb(const hsl_buffer& hsl, rgb_buffer& rgb)
+  {
+    auto size = hsl.size();
+    rgb.resize(size);
+
+    auto useAvx2 = has_avx2();
+    auto vectorSize = size / (useAvx2 ? 8 : 4) * (useAvx2 ? 8 : 4);
+    (useAvx2 ? hsl_to_rgb_simd<float_x8> : hsl_to_rgb_simd<float_x4>)(hsl, rgb, vectorSize);
+
+    for (auto i = vectorSize; i < size; i++)
+    {
+      auto result = hsl_to_rgb(Colors::hsl{ hsl.h[i], hsl.s[i], hsl.l[i] });
+      rgb.r[i] = result.r;
+      rgb.g[i] = result.g;
+      rgb.b[i] = result.b;
+    }
+  }
+
   struct linear_transfer_function
   {
     std::vector<float2> points;
@@ -135,38 +227,30 @@ namespace AxoLight::Colors
 
   const float _maxLightness = 0.7f;
 
-  void enhance(std::vector<rgb>& colors)
+  float lightness_factor(const std::vector<rgb>& colors)
   {
-    uint32_t sumLightness = 0u;
+    if (colors.empty()) return 1.f;
 
+    uint32_t sumLightness = 0u;
     for (auto& color : colors)
     {
-      /*rgb corrected;
-      corrected.r = min(255.0, max(0.0, 0.8005918860435486 * color.r + 0.23673559725284576 * color.g + 0.054503846913576126 * color.b + 0.07293142378330231 * 255));
-      corrected.g = min(255.0, max(0.0, 0.018977604806423187 * color.r + 0.9645366072654724 * color.g + 0.06882637739181519 * color.b + 0.04205838590860367 * 255));
-      corrected.b = min(255.0, max(0.0, 0.0500728040933609 * color.r + -0.060099828988313675 * color.g + 1.0020443201065063 * color.b + 0.01855257712304592 * 255));
-      color = corrected;*/
-
-      /*auto hsl = rgb_to_hsl(color);
-      hsl.s = saturation_tf(hsl.s);
-      hsl.l = brightness_tf(hsl.l);
-      color = hsl_to_rgb(hsl);*/
-
-      //color.apply_gamma(2.4f);
-
       sumLightness += color.r / 2 + color.g / 2 + 2 * color.b;
     }
 
     auto avgLightness = sumLightness / 255.f / 3.f / colors.size();
-    if (avgLightness > _maxLightness)
+    return avgLightness > _maxLightness ? _maxLightness / avgLightness : 1.f;
+  }
+
+  void enhance(std::vector<rgb>& colors)
+  {
+    auto factor = lightness_factor(colors);
+    if (factor == 1.f) return;
+
+    for (auto& rgb : colors)
     {
-      auto factor = _maxLightness / avgLightness;
-      for (auto& rgb : colors)
-      {
-        rgb.r *= factor;
-        rgb.g *= factor;
-        rgb.b *= factor;
-      }
+      rgb.r *= factor;
+      rgb.g *= factor;
+      rgb.b *= factor;
     }
   }
   
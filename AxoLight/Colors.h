@@ -16,10 +16,35 @@ namespace AxoLight::Colors
     float h, s, l;
   };
 
+  //Structure of arrays color buffers for batch conversions
+  struct rgb_buffer
+  {
+    std::vector<uint8_t> r, g, b;
+
+    size_t size() const { return r.size(); }
+    void resize(size_t size);
+  };
+
+  struct hsl_buffer
+  {
+    std::vector<float> h, s, l;
+
+    size_t size() const { return h.size(); }
+    void resize(size_t size);
+  };
+
   hsl rgb_to_hsl(const rgb& rgb);
 
   rgb hsl_to_rgb(const hsl& hsl);
 
+  //Batch versions of the above, vectorized and matching the single color versions to within one level
+  void rgb_to_hsl(const rgb_buffer& rgb, hsl_buffer& hsl);
+
+  void hsl_to_rgb(const hsl_buffer& hsl, rgb_buffer& rgb);
+
+  //Factor scaling the colors down to the maximum average lightness, or 1 if they are below it
+  float lightness_factor(const std::vector<rgb>& colors);
+
   void enhance(std::vector<rgb>& colors);
 
   rgb lerp(const rgb& a, const rgb& b, float factor);
@@ -0,0 +1,309 @@
+#include "pch.h"
+#include "CpuSampler.h"
+#include "Simd.h"
+
+using namespace AxoLight::Simd;
+
+using namespace std;
+
+namespace AxoLight::Sampling
+{
+  typedef cpu_sampler::sample_grid sample_grid;
+
+  sample_grid make_sample_grid(const frame_view& frame, const rect& rect)
+  {
+    sample_grid grid;
+
+    auto stepX = (rect.right - rect.left) / cpu_sampler::sample_points;
+    auto stepY = (rect.top - rect.bottom) / cpu_sampler::sample_points;
+    for (auto i = 0u; i < cpu_sampler::sample_points; i++)
+    {
+      auto x = int32_t((rect.left + stepX * i) * frame.width);
+      grid.columns[i] = clamp(x, 0, int32_t(frame.width) - 1);
+
+      auto y = int32_t((1.f - (rect.bottom + stepY * i)) * frame.height);
+      grid.rows[i] = uint32_t(clamp(y, 0, int32_t(frame.height) - 1));
+    }
+
+    grid.bounds = {
+      grid.columns.front(),
+      int32_t(grid.rows.back()),
+      grid.columns.back() + 1,
+      int32_t(grid.rows.front()) + 1
+    };
+
+    return grid;
+  }
+
+  array<uint32_t, 4> finish_sample(uint64_t r, uint64_t g, uint64_t b, uint64_t w)
+  {
+    if (w == 0u) return { 0u, 0u, 0u, 0u };
+    return { uint32_t(r / w), uint32_t(g / w), uint32_t(b / w), 1u };
+  }
+
+  array<uint32_t, 4> sample_rect_scalar(const frame_view& frame, const sample_grid& grid, const SamplingOptions& options)
+  {
+    uint32_t r = 0u, g = 0u, b = 0u, w = 0u;
+    for (auto row : grid.rows)
+    {
+      auto pixels = frame.row(row);
+      for (auto column : grid.columns)
+      {
+        auto pixel = pixels[column];
+        auto value = transfer_lut::transform({ uint8_t(pixel >> 16), uint8_t(pixel >> 8), uint8_t(pixel) }, options);
+        r += value[0];
+        g += value[1];
+        b += value[2];
+        w += value[3];
+      }
+    }
+
+    return finish_sample(r, g, b, w);
+  }
+
+  template<typename TFloat>
+  TFloat to_lattice(const TFloat& value)
+  {
+    return to_float(to_int(value * TFloat(1.f / transfer_lut::step) + TFloat(0.5f)));
+  }
+
+  //Looks up the nearest point of the transfer table for each pixel, one pixel per lane
+  template<typename TFloat>
+  array<uint32_t, 4> sample_rect_simd(const frame_view& frame, const sample_grid& grid, const transfer_lut& transferLut)
+  {
+    typedef typename TFloat::int_t TInt;
+    static_assert(cpu_sampler::sample_points % TFloat::width == 0);
+
+    //Each entry is two words, red and green then blue and weight
+    auto words = reinterpret_cast<const uint32_t*>(transferLut.entries.data());
+    auto size = TFloat(float(transfer_lut::size));
+
+    TInt sumR(0), sumG(0), sumB(0), sumW(0);
+    for (auto row : grid.rows)
+    {
+      auto pixels = frame.row(row);
+      for (auto i = 0u; i < cpu_sampler::sample_points; i += TFloat::width)
+      {
+        auto pixel = TInt::gather(pixels, grid.columns.data() + i);
+
+        auto r = to_lattice(to_float((pixel >> 16) & TInt(0xff)));
+        auto g = to_lattice(to_float((pixel >> 8) & TInt(0xff)));
+        auto b = to_lattice(to_float(pixel & TInt(0xff)));
+
+        auto index = to_int((r * size + g) * size + b) << 1;
+        auto redGreen = TInt::gather(words, index);
+        auto blueWeight = TInt::gather(words, index + TInt(1));
+
+        sumR = sumR + (redGreen & TInt(0xffff));
+        sumG = sumG + (redGreen >> 16);
+        sumB = sumB + (blueWeight & TInt(0xffff));
+        sumW = sumW + (blueWeight >> 16);
+      }
+    }
+
+    return finish_sample(
+      uint32_t(horizontal_sum(sumR)),
+      uint32_t(horizontal_sum(sumG)),
+      uint32_t(horizontal_sum(sumB)),
+      uint32_t(horizontal_sum(sumW)));
+  }
+
+  uint64_t hash_samples(const frame_view& frame, const sample_grid& grid)
+  {
+    const uint64_t prime = 0x100000001b3ull;
+
+    array<uint64_t, 4> hashes = { 0xcbf29ce484222325ull, 0x84222325cbf29ce4ull, 0xcbf29ce484222325ull, 0x84222325cbf29ce4ull };
+    for (auto row : grid.rows)
+    {
+      auto pixels = frame.row(row);
+      for (auto i = 0u; i < cpu_sampler::sample_points; i += 4)
+      {
+        hashes[0] = (hashes[0] ^ pixels[grid.columns[i + 0]]) * prime;
+        hashes[1] = (hashes[1] ^ pixels[grid.columns[i + 1]]) * prime;
+        hashes[2] = (hashes[2] ^ pixels[grid.columns[i + 2]]) * prime;
+        hashes[3] = (hashes[3] ^ pixels[grid.columns[i + 3]]) * prime;
+      }
+    }
+
+    return ((hashes[0] * prime ^ hashes[1]) * prime ^ hashes[2]) * prime ^ hashes[3];
+  }
+
+  bool intersects(const RECT& a, const RECT& b)
+  {
+    return a.left < b.right && a.right > b.left && a.top < b.bottom && a.bottom > b.top;
+  }
+
+  bool contains(const RECT& outer, const RECT& inner)
+  {
+    return outer.left <= inner.left && outer.right >= inner.right && outer.top <= inner.top && outer.bottom >= inner.bottom;
+  }
+
+  cpu_sampler::cpu_sampler(const std::vector<rect>& rects, const SamplingOptions& options) :
+    _rects(rects),
+    _transferLut(options),
+    _useAvx2(has_avx2()),
+    _isIncremental(options.IsIncremental),
+    _isSummedArea(options.Mode == SamplerMode::SummedArea),
+    _isDownscaled(options.IsDownscaled)
+  { }
+
+  void cpu_sampler::update_grids(const frame_view& sourceFrame)
+  {
+    _width = sourceFrame.width;
+    _height = sourceFrame.height;
+
+    //Grids and boxes are laid out on the sampled level, only its size matters here
+    _level = _isDownscaled ? choose_level(_rects, _width, _height) : 0u;
+    frame_view frame{ nullptr, _width >> _level, _height >> _level, 0u };
+
+    _pyramidRegions.clear();
+    if (_level > 0u)
+    {
+      vector<RECT> boxes;
+      boxes.reserve(_rects.size());
+      for (auto& rect : _rects)
+      {
+        boxes.push_back(to_pixel_box(rect, frame.width, frame.height));
+      }
+
+      for (auto& band : get_border_bands(boxes, frame.width, frame.height))
+      {
+        _pyramidRegions.push_back({ band.left << _level, band.top << _level, band.right << _level, band.bottom << _level });
+      }
+    }
+
+    _grids.clear();
+    _grids.reserve(_rects.size());
+    _boxes.clear();
+    _boxes.reserve(_rects.size());
+    for (auto& rect : _rects)
+    {
+      _grids.push_back(make_sample_grid(frame, rect));
+      _boxes.push_back(make_box(frame, rect));
+    }
+
+    //Each box lies in the band of its nearest edge, which is the first containing it
+    _bands = get_border_bands(_boxes, frame.width, frame.height);
+    _summedAreas.resize(_bands.size());
+    _boxBands.clear();
+    _boxBands.reserve(_boxes.size());
+    for (auto& box : _boxes)
+    {
+      auto band = find_if(_bands.begin(), _bands.end(), [&](const RECT& band) { return contains(band, box); });
+      _boxBands.push_back(uint32_t(band - _bands.begin()));
+    }
+
+    _hashes.clear();
+  }
+
+  bool cpu_sampler::is_changed(const frame_view& frame, uint32_t index)
+  {
+    auto& grid = _grids[index];
+    if (frame.dirty_rects && none_of(frame.dirty_rects->begin(), frame.dirty_rects->end(), [&](const RECT& dirtyRect) { return intersects(grid.bounds, dirtyRect); }))
+    {
+      return false;
+    }
+
+    auto hash = hash_samples(frame, grid);
+    if (_hashes[index] == hash) return false;
+
+    _hashes[index] = hash;
+    return true;
+  }
+
+  const std::vector<uint32_t>& cpu_sampler::run(const frame_view& sourceFrame, std::vector<std::array<uint32_t, 4>>& sums)
+  {
+    auto isFullUpdate = !_isIncremental || sourceFrame.width != _width || sourceFrame.height != _height || sums.size() != _rects.size();
+    if (sourceFrame.width != _width || sourceFrame.height != _height) update_grids(sourceFrame);
+
+    auto& frame = _pyramid.update(sourceFrame, _level, _pyramidRegions);
+
+    if (_isSummedArea)
+    {
+      run_summed_area(frame, sums, isFullUpdate);
+      return _changedRects;
+    }
+
+    if (_isIncremental && _hashes.size() != _rects.size())
+    {
+      _hashes.resize(_rects.size());
+      for (auto i = 0u; i < _rects.size(); i++)
+      {
+        _hashes[i] = hash_samples(frame, _grids[i]);
+      }
+      isFullUpdate = true;
+    }
+
+    sums.resize(_rects.size());
+    _changedRects.clear();
+    for (auto i = 0u; i < _rects.size(); i++)
+    {
+      if (!isFullUpdate && !is_changed(frame, i)) continue;
+
+      sums[i] = _useAvx2 ? sample_rect_simd<float_x8>(frame, _grids[i], _transferLut) : sample_rect_simd<float_x4>(frame, _grids[i], _transferLut);
+      _changedRects.push_back(i);
+    }
+
+    return _changedRects;
+  }
+
+  void cpu_sampler::run_summed_area(const frame_view& frame, std::vector<std::array<uint32_t, 4>>& sums, bool isFullUpdate)
+  {
+    for (size_t i = 0u; i < _bands.size(); i++)
+    {
+      _summedAreas[i].update(frame, _transferLut, _bands[i]);
+    }
+
+    //The table is rebuilt every frame, so changes are found by comparing the results
+    sums.resize(_rects.size());
+    _changedRects.clear();
+    for (auto i = 0u; i < _rects.size(); i++)
+    {
+      auto sum = _summedAreas[_boxBands[i]].sum(_boxes[i]);
+      auto result = finish_sample(sum[0], sum[1], sum[2], sum[3]);
+      if (!isFullUpdate && result == sums[i]) continue;
+
+      sums[i] = result;
+      _changedRects.push_back(i);
+    }
+  }
+
+  RECT cpu_sampler::make_box(const frame_view& frame, const rect& rect)
+  {
+    auto toColumn = [&](float x) { return clamp(LONG(lroundf(x * frame.width)), 0l, LONG(frame.width)); };
+    auto toRow = [&](float y) { return clamp(LONG(lroundf((1.f - y) * frame.height)), 0l, LONG(frame.height)); };
+
+    RECT box = { toColumn(rect.left), toRow(rect.top), toColumn(rect.right), toRow(rect.bottom) };
+    box.left = min(box.left, LONG(frame.width) - 1);
+    box.top = min(box.top, LONG(frame.height) - 1);
+    box.right = max(box.right, box.left + 1);
+    box.bottom = max(box.bottom, box.top + 1);
+    return box;
+  }
+
+  uint32_t cpu_sampler::choose_level(const std::vector<rect>& rects, uint32_t width, uint32_t height)
+  {
+    auto extent = float(max(width, height));
+    for (auto& rect : rects)
+    {
+      extent = min({ extent, (rect.right - rect.left) * width, (rect.top - rect.bottom) * height });
+    }
+
+    auto level = 0u;
+    while (level < frame_pyramid::max_level && extent / float(2u << level) >= float(sample_points))
+    {
+      level++;
+    }
+    return level;
+  }
+
+  uint32_t cpu_sampler::get_level() const
+  {
+    return _level;
+  }
+
+  std::array<uint32_t, 4> cpu_sampler::sample(const frame_view& frame, const rect& rect, const SamplingOptions& options)
+  {
+    return sample_rect_scalar(frame, make_sample_grid(frame, rect), options);
+  }
+}
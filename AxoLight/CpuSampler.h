@@ -0,0 +1,70 @@
+#pragma once
+#include "pch.h"
+#include "Sampling.h"
+#include "TransferLut.h"
+#include "SummedAreaTable.h"
+#include "FramePyramid.h"
+
+namespace AxoLight::Sampling
+{
+  //CPU equivalent of SamplerComputeShader.hlsl, produces the same weighted color averages per rect through the same transfer table.
+  //In summed area mode every rect is averaged over all of its pixels instead of a fixed grid, at a cost independent of the rect sizes.
+  //Only the border bands around the rects are read, with a table per band.
+  //If downscaling is enabled, the rects are sampled from the coarsest pyramid level that still has a pixel for every sample point.
+  struct cpu_sampler
+  {
+  public:
+    static const uint32_t sample_points = 32u;
+
+    struct sample_grid
+    {
+      std::array<int32_t, sample_points> columns;
+      std::array<uint32_t, sample_points> rows;
+      RECT bounds;
+    };
+
+  private:
+    std::vector<rect> _rects;
+    transfer_lut _transferLut;
+    bool _useAvx2;
+    bool _isIncremental;
+    bool _isSummedArea;
+    bool _isDownscaled;
+
+    uint32_t _width = 0u, _height = 0u;
+    uint32_t _level = 0u;
+    frame_pyramid _pyramid;
+    std::vector<RECT> _pyramidRegions;
+    std::vector<sample_grid> _grids;
+    std::vector<uint64_t> _hashes;
+    std::vector<uint32_t> _changedRects;
+
+    std::vector<RECT> _bands;
+    std::vector<summed_area_table> _summedAreas;
+    std::vector<RECT> _boxes;
+    std::vector<uint32_t> _boxBands;
+
+    void update_grids(const frame_view& frame);
+
+    bool is_changed(const frame_view& frame, uint32_t index);
+
+    void run_summed_area(const frame_view& frame, std::vector<std::array<uint32_t, 4>>& sums, bool isFullUpdate);
+
+  public:
+    cpu_sampler(const std::vector<rect>& rects, const SamplingOptions& options);
+
+    //Updates the sums of the rects whose sampled pixels changed, and returns their indices
+    const std::vector<uint32_t>& run(const frame_view& frame, std::vector<std::array<uint32_t, 4>>& sums);
+
+    //Reference implementation evaluating the exact transform for every pixel
+    static std::array<uint32_t, 4> sample(const frame_view& frame, const rect& rect, const SamplingOptions& options);
+
+    //Pixels covered by a rect in summed area mode, at least one in each direction
+    static RECT make_box(const frame_view& frame, const rect& rect);
+
+    //Pyramid level at which the smallest rect still spans sample_points pixels in both directions
+    static uint32_t choose_level(const std::vector<rect>& rects, uint32_t width, uint32_t height);
+
+    uint32_t get_level() const;
+  };
+}
@@ -0,0 +1,130 @@
+#include "pch.h"
+#include "FramePyramid.h"
+
+using namespace std;
+
+namespace AxoLight::Sampling
+{
+  //Rounding average of the four channels of two pixels
+  uint32_t average(uint32_t a, uint32_t b)
+  {
+    return (a | b) - (((a ^ b) & 0xfefefefeu) >> 1);
+  }
+
+  //Averages the 2x2 blocks of two rows into count pixels, four per iteration
+  void downscale_row(const uint32_t* above, const uint32_t* below, uint32_t* target, uint32_t count)
+  {
+    auto x = 0u;
+    for (; x + 4u <= count; x += 4u)
+    {
+      auto left = _mm_avg_epu8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(above + 2 * x)), _mm_loadu_si128(reinterpret_cast<const __m128i*>(below + 2 * x)));
+      auto right = _mm_avg_epu8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(above + 2 * x + 4)), _mm_loadu_si128(reinterpret_cast<const __m128i*>(below + 2 * x + 4)));
+
+      auto even = _mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(left), _mm_castsi128_ps(right), _MM_SHUFFLE(2, 0, 2, 0)));
+      auto odd = _mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(left), _mm_castsi128_ps(right), _MM_SHUFFLE(3, 1, 3, 1)));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(target + x), _mm_avg_epu8(even, odd));
+    }
+
+    for (; x < count; x++)
+    {
+      target[x] = average(average(above[2 * x], below[2 * x]), average(above[2 * x + 1], below[2 * x + 1]));
+    }
+  }
+
+  frame_pyramid::frame_pyramid()
+  {
+    _regions.reserve(max_regions);
+    _dirtyRects.reserve(max_regions);
+  }
+
+  const frame_view& frame_pyramid::update(const frame_view& frame, uint32_t level, const std::vector<RECT>& regions)
+  {
+    if (level == 0u) return frame;
+    if (regions.size() > max_regions) throw winrt::hresult_invalid_argument(L"The pyramid supports at most max_regions regions.");
+    level = min(level, max_level);
+
+    //Every region is widened to whole blocks of the level, so the levels in between are rebuilt wherever they are read
+    auto factor = LONG(1u << level);
+    auto align = [&](const RECT& region) {
+      return RECT{
+        region.left / factor * factor,
+        region.top / factor * factor,
+        min((region.right + factor - 1) / factor * factor, LONG(frame.width)),
+        min((region.bottom + factor - 1) / factor * factor, LONG(frame.height))
+      };
+    };
+
+    auto isPartial = frame.dirty_rects != nullptr;
+    _regions.clear();
+    if (isPartial)
+    {
+      for (auto& region : regions)
+      {
+        for (auto& dirtyRect : *frame.dirty_rects)
+        {
+          RECT dirtyRegion;
+          if (!IntersectRect(&dirtyRegion, &dirtyRect, &region)) continue;
+
+          isPartial &= _regions.size() < max_regions;
+          if (isPartial) _regions.push_back(align(dirtyRegion));
+        }
+      }
+    }
+
+    if (!isPartial)
+    {
+      _regions.clear();
+      for (auto& region : regions)
+      {
+        _regions.push_back(align(region));
+      }
+    }
+
+    auto source = &frame;
+    for (auto i = 0u; i < level; i++)
+    {
+      auto& target = _levels[i];
+      auto width = source->width / 2u;
+      auto height = source->height / 2u;
+      if (target.width != width || target.height != height)
+      {
+        _pixels[i].assign(size_t(width) * height, 0u);
+        target = { reinterpret_cast<const uint8_t*>(_pixels[i].data()), width, height, width * 4u };
+      }
+
+      auto shift = i + 1u;
+      for (auto& region : _regions)
+      {
+        auto right = min(uint32_t(region.right) >> shift, width);
+        auto bottom = min(uint32_t(region.bottom) >> shift, height);
+        auto left = uint32_t(region.left) >> shift;
+        if (left >= right) continue;
+
+        for (auto y = uint32_t(region.top) >> shift; y < bottom; y++)
+        {
+          downscale_row(source->row(2 * y) + 2 * left, source->row(2 * y + 1) + 2 * left, _pixels[i].data() + size_t(y) * width + left, right - left);
+        }
+      }
+
+      source = &target;
+    }
+
+    //The dirty rects of the returned level follow the updated regions
+    auto& result = _levels[level - 1];
+    if (isPartial)
+    {
+      _dirtyRects.clear();
+      for (auto& region : _regions)
+      {
+        _dirtyRects.push_back({ region.left >> level, region.top >> level, region.right >> level, region.bottom >> level });
+      }
+      result.dirty_rects = &_dirtyRects;
+    }
+    else
+    {
+      result.dirty_rects = nullptr;
+    }
+
+    return result;
+  }
+}
\ No newline at end of file
@@ -0,0 +1,31 @@
+#pragma once
+#include "pch.h"
+#include "Sampling.h"
+
+namespace AxoLight::Sampling
+{
+  //Box filtered copies of a frame at 1/2, 1/4 and 1/8 of its size, each level averages 2x2 pixels of the one before it.
+  //Averages round up like PAVGB, so every level may brighten the channels by up to half a step.
+  struct frame_pyramid
+  {
+  public:
+    static const uint32_t max_level = 3u;
+    static const uint32_t max_factor = 1u << max_level;
+
+    //Bound on the dirty parts of the regions updated per frame, busier frames rebuild the regions whole
+    static const size_t max_regions = 256u;
+
+  private:
+    std::array<std::vector<uint32_t>, max_level> _pixels;
+    std::array<frame_view, max_level> _levels{};
+    std::vector<RECT> _regions;
+    std::vector<RECT> _dirtyRects;
+
+  public:
+    frame_pyramid();
+
+    //Downscales the regions of the frame down to the given level and returns that level, dirty rects of the frame limit the update to them.
+    //Regions should be aligned to the factor of the level, so no level reads pixels outside of them. At most max_regions regions are supported.
+    const frame_view& update(const frame_view& frame, uint32_t level, const std::vector<RECT>& regions);
+  };
+}
\ No newline at end of file
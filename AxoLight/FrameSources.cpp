@@ -0,0 +1,303 @@
+#include "pch.h"
+#include "FrameSources.h"
+#include "FramePyramid.h"
+#include "Colors.h"
+
+using namespace AxoLight::Colors;
+using namespace AxoLight::Graphics;
+using namespace AxoLight::Sampling;
+
+using namespace std;
+using namespace std::chrono;
+using namespace winrt;
+
+namespace AxoLight::Capture
+{
+  std::unique_ptr<frame_source> frame_source::create(const FrameSourceOptions& options)
+  {
+    switch (options.Type)
+    {
+    case FrameSourceType::Desktop:
+      return make_unique<d3d11_desktop_frame_source>(get_output(options.OutputName));
+    case FrameSourceType::RawFile:
+      return make_unique<raw_file_frame_source>(options.Path, options.FrameRate);
+    case FrameSourceType::Synthetic:
+      return make_unique<synthetic_frame_source>(options.Pattern, options.Width, options.Height, options.FrameRate);
+    default:
+      throw out_of_range("Invalid frame source type!");
+    }
+  }
+
+  frame_pacer::frame_pacer(uint32_t frameRate) :
+    _frameDuration(frameRate > 0u ? duration_cast<steady_clock::duration>(seconds(1)) / frameRate : steady_clock::duration::zero()),
+    _nextFrame(steady_clock::now())
+  { }
+
+  void frame_pacer::wait()
+  {
+    if (_frameDuration == steady_clock::duration::zero()) return;
+
+    auto now = steady_clock::now();
+    if (_nextFrame > now)
+    {
+      this_thread::sleep_until(_nextFrame);
+      _nextFrame += _frameDuration;
+    }
+    else
+    {
+      _nextFrame = now + _frameDuration;
+    }
+  }
+
+  com_ptr<IDXGIAdapter> d3d11_desktop_frame_source::get_adapter(const com_ptr<IDXGIOutput2>& output)
+  {
+    com_ptr<IDXGIAdapter> adapter;
+    check_hresult(output->GetParent(__uuidof(IDXGIAdapter), adapter.put_void()));
+    return adapter;
+  }
+
+  d3d11_desktop_frame_source::d3d11_desktop_frame_source(const com_ptr<IDXGIOutput2>& output) :
+    _renderer(get_adapter(output)),
+    _duplication(_renderer.device, output)
+  {
+    //Move and dirty rects share the metadata buffer and each takes at least a RECT, so the rects never outgrow this
+    _dirtyRects.reserve(d3d11_desktop_duplication::max_metadata_size / sizeof(RECT));
+  }
+
+  const frame_view& d3d11_desktop_frame_source::lock_frame(uint16_t timeout, const std::function<void()>& timeoutCallback)
+  {
+    auto& texture = _duplication.lock_frame(timeout, timeoutCallback);
+
+    D3D11_TEXTURE2D_DESC desc;
+    texture.texture->GetDesc(&desc);
+
+    auto hasDirtyRects = _duplication.get_dirty_rects(_dirtyRects);
+    if (!_stage || _frame.width != desc.Width || _frame.height != desc.Height)
+    {
+      _stage = make_unique<d3d11_texture_2d>(d3d11_texture_2d::make_staging(_renderer.device, desc.Format, desc.Width, desc.Height));
+      update_bands(desc.Width, desc.Height);
+      hasDirtyRects = false;
+    }
+
+    //Only the border bands are read back, the interior of the staging texture is never written
+    if (hasDirtyRects)
+    {
+      for (auto& dirtyRect : _dirtyRects)
+      {
+        if (_bands.empty())
+        {
+          texture.copy_to(_renderer.context, *_stage, dirtyRect);
+          continue;
+        }
+
+        for (auto& band : _bands)
+        {
+          RECT region;
+          if (IntersectRect(&region, &dirtyRect, &band)) texture.copy_to(_renderer.context, *_stage, region);
+        }
+      }
+    }
+    else if (!_bands.empty())
+    {
+      for (auto& band : _bands)
+      {
+        texture.copy_to(_renderer.context, *_stage, band);
+      }
+    }
+    else
+    {
+      texture.copy_to(_renderer.context, *_stage);
+    }
+
+    auto mappedFrame = _stage->map(_renderer.context);
+
+    _frame = { (const uint8_t*)mappedFrame.pData, desc.Width, desc.Height, mappedFrame.RowPitch, hasDirtyRects ? &_dirtyRects : nullptr };
+    return _frame;
+  }
+
+  void d3d11_desktop_frame_source::unlock_frame()
+  {
+    _stage->unmap(_renderer.context);
+    _duplication.unlock_frame();
+  }
+
+  void d3d11_desktop_frame_source::set_sampled_rects(const std::vector<Sampling::rect>& rects)
+  {
+    //Recreating the stage makes the next frame copy every band in full
+    _sampledRects = rects;
+    _stage.reset();
+  }
+
+  void d3d11_desktop_frame_source::update_bands(uint32_t width, uint32_t height)
+  {
+    vector<RECT> boxes;
+    boxes.reserve(_sampledRects.size());
+    for (auto& rect : _sampledRects)
+    {
+      boxes.push_back(to_pixel_box(rect, width, height));
+    }
+
+    //Aligned to the coarsest pyramid level, so downscaling never reads pixels outside of the bands
+    _bands = get_border_bands(boxes, width, height, frame_pyramid::max_factor);
+  }
+
+  raw_file_frame_source::raw_file_frame_source(const std::filesystem::path& path, uint32_t frameRate) :
+    _view(nullptr, &UnmapViewOfFile),
+    _pacer(frameRate)
+  {
+    _file = file_handle(CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr));
+    if (!_file) throw_last_error();
+
+    _mapping = handle(CreateFileMappingW(_file.get(), nullptr, PAGE_READONLY, 0, 0, nullptr));
+    if (!_mapping) throw_last_error();
+
+    _view.reset(MapViewOfFile(_mapping.get(), FILE_MAP_READ, 0, 0, 0));
+    if (!_view) throw_last_error();
+
+    LARGE_INTEGER fileSize;
+    check_bool(GetFileSizeEx(_file.get(), &fileSize));
+    if (uint64_t(fileSize.QuadPart) < sizeof(raw_frame_header)) throw hresult_invalid_argument(L"The raw frame file is invalid.");
+
+    //Every row must hold its pixels and every frame must lie inside the file
+    memcpy(&_header, _view.get(), sizeof(raw_frame_header));
+    if (_header.magic != raw_frame_header::magic_value || _header.frame_count == 0u ||
+      _header.width == 0u || _header.height == 0u || _header.stride < uint64_t(_header.width) * 4 ||
+      (uint64_t(fileSize.QuadPart) - sizeof(raw_frame_header)) / (uint64_t(_header.stride) * _header.height) < _header.frame_count)
+    {
+      throw hresult_invalid_argument(L"The raw frame file is invalid.");
+    }
+  }
+
+  const frame_view& raw_file_frame_source::lock_frame(uint16_t /*timeout*/, const std::function<void()>& /*timeoutCallback*/)
+  {
+    _pacer.wait();
+
+    auto frameSize = size_t(_header.stride) * _header.height;
+    auto frameData = (const uint8_t*)_view.get() + sizeof(raw_frame_header) + frameSize * _frameIndex;
+    _frame = { frameData, _header.width, _header.height, _header.stride };
+    return _frame;
+  }
+
+  void raw_file_frame_source::unlock_frame()
+  {
+    _frameIndex = (_frameIndex + 1) % _header.frame_count;
+  }
+
+  raw_file_frame_recorder::raw_file_frame_recorder(const std::filesystem::path& path, uint32_t frameRate) :
+    _header({ raw_frame_header::magic_value, 0u, 0u, 0u, 0u, frameRate })
+  {
+    _wfopen_s(&_file, path.c_str(), L"wb");
+    if (!_file) throw hresult_invalid_argument(L"Cannot open raw frame file for writing.");
+
+    fwrite(&_header, sizeof(raw_frame_header), 1, _file);
+  }
+
+  raw_file_frame_recorder::~raw_file_frame_recorder()
+  {
+    if (!_file) return;
+
+    fseek(_file, 0, SEEK_SET);
+    fwrite(&_header, sizeof(raw_frame_header), 1, _file);
+    fclose(_file);
+  }
+
+  void raw_file_frame_recorder::write(const frame_view& frame)
+  {
+    if (_header.frame_count == 0u)
+    {
+      _header.width = frame.width;
+      _header.height = frame.height;
+      _header.stride = frame.width * 4;
+    }
+    else if (frame.width != _header.width || frame.height != _header.height)
+    {
+      throw hresult_invalid_argument(L"Frame size changed during recording.");
+    }
+
+    for (auto y = 0u; y < frame.height; y++)
+    {
+      fwrite(frame.row(y), _header.stride, 1, _file);
+    }
+    _header.frame_count++;
+  }
+
+  synthetic_frame_source::synthetic_frame_source(SyntheticPattern pattern, uint32_t width, uint32_t height, uint32_t frameRate) :
+    _pattern(pattern),
+    _pixels(size_t(width) * height),
+    _pacer(frameRate)
+  {
+    _frame = { (const uint8_t*)_pixels.data(), width, height, width * 4 };
+  }
+
+  const frame_view& synthetic_frame_source::lock_frame(uint16_t /*timeout*/, const std::function<void()>& /*timeoutCallback*/)
+  {
+    _pacer.wait();
+
+    switch (_pattern)
+    {
+    case SyntheticPattern::Gradient:
+      render_gradient();
+      break;
+    case SyntheticPattern::Flash:
+      render_flash();
+      break;
+    case SyntheticPattern::MovingBars:
+      render_moving_bars();
+      break;
+    }
+
+    return _frame;
+  }
+
+  void synthetic_frame_source::unlock_frame()
+  {
+    _frameIndex++;
+  }
+
+  uint32_t to_bgra(const rgb& color)
+  {
+    return 0xff000000u | (uint32_t(color.r) << 16) | (uint32_t(color.g) << 8) | uint32_t(color.b);
+  }
+
+  void synthetic_frame_source::render_gradient()
+  {
+    auto hueOffset = float(_frameIndex % 360u);
+
+    auto firstRow = _pixels.begin();
+    for (auto x = 0u; x < _frame.width; x++)
+    {
+      auto hue = fmodf(hueOffset + 360.f * x / _frame.width, 360.f);
+      firstRow[x] = to_bgra(hsl_to_rgb({ hue, 1.f, 0.5f }));
+    }
+
+    for (auto y = 1u; y < _frame.height; y++)
+    {
+      copy(firstRow, firstRow + _frame.width, firstRow + size_t(y) * _frame.width);
+    }
+  }
+
+  void synthetic_frame_source::render_flash()
+  {
+    auto isLit = (_frameIndex / 30u) % 2u == 0u;
+    fill(_pixels.begin(), _pixels.end(), isLit ? 0xffffffffu : 0xff000000u);
+  }
+
+  void synthetic_frame_source::render_moving_bars()
+  {
+    const array<uint32_t, 4> colors = { 0xffff0000u, 0xff00ff00u, 0xff0000ffu, 0xffffffffu };
+    auto barWidth = max(_frame.width / 8u, 1u);
+    auto offset = _frameIndex * max(_frame.width / 120u, 1u);
+
+    auto firstRow = _pixels.begin();
+    for (auto x = 0u; x < _frame.width; x++)
+    {
+      auto bar = (x + offset) / barWidth;
+      firstRow[x] = bar % 2u ? 0xff000000u : colors[(bar / 2u) % colors.size()];
+    }
+
+    for (auto y = 1u; y < _frame.height; y++)
+    {
+      copy(firstRow, firstRow + _frame.width, firstRow + size_t(y) * _frame.width);
+    }
+  }
+}
@@ -0,0 +1,147 @@
+#pragma once
+#include "pch.h"
+#include "Graphics.h"
+#include "Sampling.h"
+
+namespace AxoLight::Capture
+{
+  enum class FrameSourceType
+  {
+    Desktop,
+    RawFile,
+    Synthetic
+  };
+
+  enum class SyntheticPattern
+  {
+    Gradient,
+    Flash,
+    MovingBars
+  };
+
+  struct FrameSourceOptions
+  {
+    FrameSourceType Type = FrameSourceType::Desktop;
+    std::wstring OutputName;
+    std::filesystem::path Path;
+    SyntheticPattern Pattern = SyntheticPattern::Gradient;
+    uint32_t Width = 1920;
+    uint32_t Height = 1080;
+    uint32_t FrameRate = 60;
+  };
+
+  struct frame_source
+  {
+    virtual ~frame_source() = default;
+
+    virtual const Sampling::frame_view& lock_frame(uint16_t timeout = 1000u, const std::function<void()>& timeoutCallback = nullptr) = 0;
+
+    virtual void unlock_frame() = 0;
+
+    //Limits the pixels the source has to provide to the border bands of the given rects, the rest of the frame may be left stale
+    virtual void set_sampled_rects(const std::vector<Sampling::rect>& /*rects*/) { }
+
+    static std::unique_ptr<frame_source> create(const FrameSourceOptions& options);
+  };
+
+  struct frame_pacer
+  {
+  private:
+    std::chrono::steady_clock::duration _frameDuration;
+    std::chrono::steady_clock::time_point _nextFrame;
+
+  public:
+    frame_pacer(uint32_t frameRate);
+
+    void wait();
+  };
+
+  struct d3d11_desktop_frame_source : public frame_source
+  {
+  private:
+    Graphics::d3d11_renderer _renderer;
+    Graphics::d3d11_desktop_duplication _duplication;
+    std::unique_ptr<Graphics::d3d11_texture_2d> _stage;
+    std::vector<RECT> _dirtyRects;
+    std::vector<Sampling::rect> _sampledRects;
+    std::vector<RECT> _bands;
+    Sampling::frame_view _frame{};
+
+    static winrt::com_ptr<IDXGIAdapter> get_adapter(const winrt::com_ptr<IDXGIOutput2>& output);
+
+    void update_bands(uint32_t width, uint32_t height);
+
+  public:
+    d3d11_desktop_frame_source(const winrt::com_ptr<IDXGIOutput2>& output);
+
+    virtual const Sampling::frame_view& lock_frame(uint16_t timeout = 1000u, const std::function<void()>& timeoutCallback = nullptr) override;
+
+    virtual void unlock_frame() override;
+
+    virtual void set_sampled_rects(const std::vector<Sampling::rect>& rects) override;
+  };
+
+  //Raw frame files: a raw_frame_header followed by frame_count B8G8R8A8 frames of stride * height bytes each
+  struct raw_frame_header
+  {
+    static const uint32_t magic_value = 0x464f5841; //AXOF
+
+    uint32_t magic;
+    uint32_t width, height, stride;
+    uint32_t frame_count;
+    uint32_t frame_rate;
+  };
+
+  struct raw_file_frame_source : public frame_source
+  {
+  private:
+    winrt::file_handle _file;
+    winrt::handle _mapping;
+    std::unique_ptr<void, decltype(&UnmapViewOfFile)> _view;
+    raw_frame_header _header;
+    frame_pacer _pacer;
+    uint32_t _frameIndex = 0u;
+    Sampling::frame_view _frame{};
+
+  public:
+    raw_file_frame_source(const std::filesystem::path& path, uint32_t frameRate);
+
+    virtual const Sampling::frame_view& lock_frame(uint16_t timeout = 1000u, const std::function<void()>& timeoutCallback = nullptr) override;
+
+    virtual void unlock_frame() override;
+  };
+
+  struct raw_file_frame_recorder
+  {
+  private:
+    FILE* _file = nullptr;
+    raw_frame_header _header;
+
+  public:
+    raw_file_frame_recorder(const std::filesystem::path& path, uint32_t frameRate);
+    ~raw_file_frame_recorder();
+
+    void write(const Sampling::frame_view& frame);
+  };
+
+  struct synthetic_frame_source : public frame_source
+  {
+  private:
+    SyntheticPattern _pattern;
+    uint32_t _frameIndex = 0u;
+    std::vector<uint32_t> _pixels;
+    frame_pacer _pacer;
+    Sampling::frame_view _frame{};
+
+    void render_gradient();
+    void render_flash();
+    void render_moving_bars();
+
+  public:
+    synthetic_frame_source(SyntheticPattern pattern, uint32_t width, uint32_t height, uint32_t frameRate);
+
+    virtual const Sampling::frame_view& lock_frame(uint16_t timeout = 1000u, const std::function<void()>& timeoutCallback = nullptr) override;
+
+    virtual void unlock_frame() override;
+  };
+}
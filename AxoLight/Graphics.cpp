@@ -1,5 +1,6 @@
 #include "pch.h"
 #include "Graphics.h"
+#include "Tracing.h"
 using namespace AxoLight::Infrastructure;
 
 using namespace std;
@@ -8,6 +9,11 @@ using namespace winrt;
 namespace AxoLight::Graphics
 {
   winrt::com_ptr<IDXGIOutput2> get_default_output()
+  {
+    return get_output({});
+  }
+
+  winrt::com_ptr<IDXGIOutput2> get_output(const std::wstring& name)
   {
     com_ptr<IDXGIFactory> dxgiFactory = nullptr;
     check_hresult(CreateDXGIFactory2(0, __uuidof(IDXGIFactory), dxgiFactory.put_void()));
@@ -21,8 +27,11 @@ namespace AxoLight::Graphics
       com_ptr<IDXGIOutput> dxgiOutput;
       for (uint32_t outputIndex = 0u; dxgiAdapter->EnumOutputs(outputIndex, dxgiOutput.put()) != DXGI_ERROR_NOT_FOUND; outputIndex++)
       {
+        DXGI_OUTPUT_DESC dxgiOutputDesc;
+        check_hresult(dxgiOutput->GetDesc(&dxgiOutputDesc));
+
         auto dxgiOutput2 = dxgiOutput.try_as<IDXGIOutput2>();
-        if (dxgiOutput2) return dxgiOutput2;
+        if (dxgiOutput2 && (name.empty() || name == dxgiOutputDesc.DeviceName || L"\\\\.\\" + name == dxgiOutputDesc.DeviceName)) return dxgiOutput2;
 
         dxgiOutput = nullptr;
       }
@@ -113,6 +122,39 @@ namespace AxoLight::Graphics
     view(make_view(texture))
   { }
   
+  d3d11_texture_2d d3d11_texture_2d::make_staging(const com_ptr<ID3D11Device>& device, DXGI_FORMAT format, uint32_t width, uint32_t height)
+  {
+    CD3D11_TEXTURE2D_DESC desc(format, width, height, 1, 1, 0, D3D11_USAGE_STAGING, D3D11_CPU_ACCESS_READ);
+
+    com_ptr<ID3D11Texture2D> texture;
+    check_hresult(device->CreateTexture2D(&desc, nullptr, texture.put()));
+
+    return d3d11_texture_2d(texture);
+  }
+
+  void d3d11_texture_2d::copy_to(const com_ptr<ID3D11DeviceContext>& context, const d3d11_texture_2d& target) const
+  {
+    context->CopyResource(target.resource.get(), resource.get());
+  }
+
+  void d3d11_texture_2d::copy_to(const com_ptr<ID3D11DeviceContext>& context, const d3d11_texture_2d& target, const RECT& region) const
+  {
+    D3D11_BOX box{ uint32_t(region.left), uint32_t(region.top), 0u, uint32_t(region.right), uint32_t(region.bottom), 1u };
+    context->CopySubresourceRegion(target.resource.get(), 0, box.left, box.top, 0, resource.get(), 0, &box);
+  }
+
+  D3D11_MAPPED_SUBRESOURCE d3d11_texture_2d::map(const com_ptr<ID3D11DeviceContext>& context) const
+  {
+    D3D11_MAPPED_SUBRESOURCE mappedSubresource = {};
+    check_hresult(context->Map(resource.get(), 0, D3D11_MAP_READ, 0, &mappedSubresource));
+    return mappedSubresource;
+  }
+
+  void d3d11_texture_2d::unmap(const com_ptr<ID3D11DeviceContext>& context) const
+  {
+    context->Unmap(resource.get(), 0);
+  }
+  
   void d3d11_texture_2d::set(const com_ptr<ID3D11DeviceContext>& context, d3d11_shader_stage stage, uint32_t slot) const
   {
     const array<ID3D11ShaderResourceView*, 1> views = { view.get() };
@@ -132,6 +174,41 @@ namespace AxoLight::Graphics
     }
   }
   
+  com_ptr<ID3D11ShaderResourceView> d3d11_texture_3d::make_view(const com_ptr<ID3D11Texture3D>& texture)
+  {
+    com_ptr<ID3D11Device> device;
+    texture->GetDevice(device.put());
+
+    com_ptr<ID3D11ShaderResourceView> view;
+    check_hresult(device->CreateShaderResourceView(texture.get(), nullptr, view.put()));
+    return view;
+  }
+
+  d3d11_texture_3d::d3d11_texture_3d(const com_ptr<ID3D11Texture3D>& texture) :
+    d3d11_resource(texture),
+    texture(texture),
+    view(make_view(texture))
+  { }
+
+  void d3d11_texture_3d::set(const com_ptr<ID3D11DeviceContext>& context, d3d11_shader_stage stage, uint32_t slot) const
+  {
+    const array<ID3D11ShaderResourceView*, 1> views = { view.get() };
+    switch (stage)
+    {
+    case d3d11_shader_stage::cs:
+      context->CSSetShaderResources(slot, 1, views.data());
+      break;
+    case d3d11_shader_stage::vs:
+      context->VSSetShaderResources(slot, 1, views.data());
+      break;
+    case d3d11_shader_stage::ps:
+      context->PSSetShaderResources(slot, 1, views.data());
+      break;
+    default:
+      throw out_of_range("Invalid shader stage for texture!");
+    }
+  }
+
   com_ptr<ID3D11RenderTargetView> d3d11_render_target_2d::get_view(const com_ptr<ID3D11Texture2D>& texture)
   {
     com_ptr<ID3D11Device> device;
@@ -461,22 +538,26 @@ namespace AxoLight::Graphics
   d3d11_desktop_duplication::d3d11_desktop_duplication(const com_ptr<ID3D11Device>& device, const com_ptr<IDXGIOutput2>& output) :
     device(device),
     output(output)
-  { }
+  {
+    _metadata.resize(max_metadata_size);
+  }
   
-  d3d11_texture_2d& d3d11_desktop_duplication::lock_frame(uint16_t timeout, std::function<void()> timeoutCallback)
+  d3d11_texture_2d& d3d11_desktop_duplication::lock_frame(uint16_t timeout, const std::function<void()>& timeoutCallback)
   {
     com_ptr<IDXGIResource> resource;
     do
     {
       if (_outputDuplication == nullptr)
       {
+        auto start = chrono::steady_clock::now();
         output->DuplicateOutput(device.get(), _outputDuplication.put());
+        _isNewDuplication = true;
+        trace_buffer::record("duplicate output", start, chrono::steady_clock::now());
       }
 
       if (_outputDuplication != nullptr)
       {
-        DXGI_OUTDUPL_FRAME_INFO frameInfo;
-        auto result = _outputDuplication->AcquireNextFrame(timeout, &frameInfo, resource.put());
+        auto result = _outputDuplication->AcquireNextFrame(timeout, &_frameInfo, resource.put());
         if (result == DXGI_ERROR_WAIT_TIMEOUT)
         {
           if (timeoutCallback) timeoutCallback();
@@ -504,5 +585,30 @@ namespace AxoLight::Graphics
   void d3d11_desktop_duplication::unlock_frame()
   {
     _outputDuplication->ReleaseFrame();
+    _isNewDuplication = false;
+  }
+
+  bool d3d11_desktop_duplication::get_dirty_rects(std::vector<RECT>& rects)
+  {
+    rects.clear();
+    if (_isNewDuplication) return false;
+    if (_frameInfo.TotalMetadataBufferSize == 0) return true;
+    if (_frameInfo.TotalMetadataBufferSize > _metadata.size()) return false;
+
+    uint32_t moveRectsSize = 0u;
+    if (FAILED(_outputDuplication->GetFrameMoveRects(uint32_t(_metadata.size()), (DXGI_OUTDUPL_MOVE_RECT*)_metadata.data(), &moveRectsSize))) return false;
+
+    auto moveRects = (DXGI_OUTDUPL_MOVE_RECT*)_metadata.data();
+    for (auto i = 0u; i < moveRectsSize / sizeof(DXGI_OUTDUPL_MOVE_RECT); i++)
+    {
+      rects.push_back(moveRects[i].DestinationRect);
+    }
+
+    uint32_t dirtyRectsSize = 0u;
+    if (FAILED(_outputDuplication->GetFrameDirtyRects(uint32_t(_metadata.size()), (RECT*)_metadata.data(), &dirtyRectsSize))) return false;
+
+    auto dirtyRects = (RECT*)_metadata.data();
+    rects.insert(rects.end(), dirtyRects, dirtyRects + dirtyRectsSize / sizeof(RECT));
+    return true;
   }
 }
\ No newline at end of file
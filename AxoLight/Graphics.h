@@ -6,6 +6,9 @@ namespace AxoLight::Graphics
 {
   winrt::com_ptr<IDXGIOutput2> get_default_output();
 
+  //Finds an output by its device name, with or without the \\.\ prefix, an empty name returns the default output
+  winrt::com_ptr<IDXGIOutput2> get_output(const std::wstring& name);
+
   struct d3d11_renderer
   {
   protected:
@@ -69,6 +72,46 @@ namespace AxoLight::Graphics
       return d3d11_texture_2d(texture);
     }
 
+    static d3d11_texture_2d make_staging(const winrt::com_ptr<ID3D11Device>& device, DXGI_FORMAT format, uint32_t width, uint32_t height);
+
+    void set(const winrt::com_ptr<ID3D11DeviceContext>& context, d3d11_shader_stage stage, uint32_t slot = 0u) const;
+
+    void copy_to(const winrt::com_ptr<ID3D11DeviceContext>& context, const d3d11_texture_2d& target) const;
+
+    void copy_to(const winrt::com_ptr<ID3D11DeviceContext>& context, const d3d11_texture_2d& target, const RECT& region) const;
+
+    D3D11_MAPPED_SUBRESOURCE map(const winrt::com_ptr<ID3D11DeviceContext>& context) const;
+
+    void unmap(const winrt::com_ptr<ID3D11DeviceContext>& context) const;
+  };
+
+  struct d3d11_texture_3d : d3d11_resource
+  {
+  private:
+    static winrt::com_ptr<ID3D11ShaderResourceView> make_view(const winrt::com_ptr<ID3D11Texture3D>& texture);
+
+  public:
+    const winrt::com_ptr<ID3D11Texture3D> texture;
+    const winrt::com_ptr<ID3D11ShaderResourceView> view;
+
+    d3d11_texture_3d(const winrt::com_ptr<ID3D11Texture3D>& texture);
+
+    template<typename TItem>
+    static d3d11_texture_3d make_immutable(const winrt::com_ptr<ID3D11Device>& device, DXGI_FORMAT format, uint32_t width, uint32_t height, uint32_t depth, const winrt::array_view<const TItem>& voxels)
+    {
+      CD3D11_TEXTURE3D_DESC desc(format, width, height, depth, 1, D3D11_BIND_SHADER_RESOURCE, D3D11_USAGE_IMMUTABLE);
+
+      D3D11_SUBRESOURCE_DATA data = {};
+      data.pSysMem = voxels.data();
+      data.SysMemPitch = width * sizeof(TItem);
+      data.SysMemSlicePitch = width * height * sizeof(TItem);
+
+      winrt::com_ptr<ID3D11Texture3D> texture;
+      winrt::check_hresult(device->CreateTexture3D(&desc, &data, texture.put()));
+
+      return d3d11_texture_3d(texture);
+    }
+
     void set(const winrt::com_ptr<ID3D11DeviceContext>& context, d3d11_shader_stage stage, uint32_t slot = 0u) const;
   };
 
@@ -363,16 +406,22 @@ namespace AxoLight::Graphics
       context->CopyResource(target.resource.get(), resource.get());
     }
 
-    std::vector<item_t> get_data(const winrt::com_ptr<ID3D11DeviceContext>& context)
+    void get_data(const winrt::com_ptr<ID3D11DeviceContext>& context, std::vector<item_t>& items)
     {
       D3D11_MAPPED_SUBRESOURCE mappedSubresource = {};
 
       winrt::check_hresult(context->Map(buffer.get(), 0, D3D11_MAP_READ, 0, &mappedSubresource));
 
-      std::vector<item_t> items(capacity);
+      items.resize(capacity);
       memcpy(items.data(), mappedSubresource.pData, capacity * sizeof(item_t));
 
       context->Unmap(buffer.get(), 0);
+    }
+
+    std::vector<item_t> get_data(const winrt::com_ptr<ID3D11DeviceContext>& context)
+    {
+      std::vector<item_t> items;
+      get_data(context, items);
       return items;
     }
 
@@ -519,15 +568,23 @@ namespace AxoLight::Graphics
   private:
     winrt::com_ptr<IDXGIOutputDuplication> _outputDuplication;
     std::unique_ptr<d3d11_texture_2d> _texture;
+    DXGI_OUTDUPL_FRAME_INFO _frameInfo = {};
+    bool _isNewDuplication = true;
+    std::vector<uint8_t> _metadata;
 
   public:
+    //Frames with more move and dirty rects than fit are reported as fully changed
+    static const uint32_t max_metadata_size = 64u * 1024u;
+
     const winrt::com_ptr<ID3D11Device> device;
     const winrt::com_ptr<IDXGIOutput2> output;
 
     d3d11_desktop_duplication(const winrt::com_ptr<ID3D11Device>& device, const winrt::com_ptr<IDXGIOutput2>& output);
 
-    d3d11_texture_2d& lock_frame(uint16_t timeout = 1000u, std::function<void()> timeoutCallback = nullptr);
+    d3d11_texture_2d& lock_frame(uint16_t timeout = 1000u, const std::function<void()>& timeoutCallback = nullptr);
 
     void unlock_frame();
+
+    bool get_dirty_rects(std::vector<RECT>& rects);
   };
 }
\ No newline at end of file
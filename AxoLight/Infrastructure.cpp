@@ -4,6 +4,46 @@
 using namespace std;
 using namespace winrt;
 
+#ifndef NDEBUG
+namespace
+{
+  thread_local size_t _threadAllocationCount = 0u;
+  thread_local bool _isCountingAllocations = true;
+
+  void* counted_allocate(size_t size)
+  {
+    if (_isCountingAllocations) _threadAllocationCount++;
+
+    auto result = malloc(size > 0 ? size : 1);
+    if (!result) throw bad_alloc();
+    return result;
+  }
+
+  void* counted_allocate(size_t size, align_val_t alignment)
+  {
+    if (_isCountingAllocations) _threadAllocationCount++;
+
+    auto result = _aligned_malloc(size > 0 ? size : 1, size_t(alignment));
+    if (!result) throw bad_alloc();
+    return result;
+  }
+}
+
+void* operator new(size_t size) { return counted_allocate(size); }
+void* operator new[](size_t size) { return counted_allocate(size); }
+void* operator new(size_t size, align_val_t alignment) { return counted_allocate(size, alignment); }
+void* operator new[](size_t size, align_val_t alignment) { return counted_allocate(size, alignment); }
+
+void operator delete(void* pointer) noexcept { free(pointer); }
+void operator delete[](void* pointer) noexcept { free(pointer); }
+void operator delete(void* pointer, size_t) noexcept { free(pointer); }
+void operator delete[](void* pointer, size_t) noexcept { free(pointer); }
+void operator delete(void* pointer, align_val_t) noexcept { _aligned_free(pointer); }
+void operator delete[](void* pointer, align_val_t) noexcept { _aligned_free(pointer); }
+void operator delete(void* pointer, size_t, align_val_t) noexcept { _aligned_free(pointer); }
+void operator delete[](void* pointer, size_t, align_val_t) noexcept { _aligned_free(pointer); }
+#endif
+
 namespace AxoLight::Infrastructure
 {
   std::filesystem::path get_root()
@@ -82,4 +122,65 @@ namespace AxoLight::Infrastructure
     WaitForSingleObject(hEvent, INFINITE);
     return hWnd;
   }
+
+  size_t allocation_count()
+  {
+#ifndef NDEBUG
+    return _threadAllocationCount;
+#else
+    return 0u;
+#endif
+  }
+
+  bool is_counting_allocations()
+  {
+#ifndef NDEBUG
+    return true;
+#else
+    return false;
+#endif
+  }
+
+  allocation_exemption::allocation_exemption()
+  {
+#ifndef NDEBUG
+    _wasCounting = _isCountingAllocations;
+    _isCountingAllocations = false;
+#else
+    _wasCounting = false;
+#endif
+  }
+
+  allocation_exemption::~allocation_exemption()
+  {
+#ifndef NDEBUG
+    _isCountingAllocations = _wasCounting;
+#endif
+  }
+
+  allocation_monitor::allocation_monitor(uint32_t warmupFrames) :
+    _warmupFrames(warmupFrames)
+  { }
+
+  void allocation_monitor::begin_frame()
+  {
+    _allocationCount = allocation_count();
+  }
+
+  size_t allocation_monitor::end_frame()
+  {
+    if (_warmupFrames > 0u)
+    {
+      _warmupFrames--;
+      return 0u;
+    }
+
+    auto allocationCount = allocation_count() - _allocationCount;
+    if (allocationCount > 0u)
+    {
+      allocation_exemption exemption;
+      OutputDebugStringW((L"The frame loop allocated " + to_wstring(allocationCount) + L" times after warm-up.\n").c_str());
+    }
+    return allocationCount;
+  }
 }
\ No newline at end of file
@@ -10,4 +10,41 @@ namespace AxoLight::Infrastructure
   LRESULT CALLBACK debug_message_handler(HWND windowHandle, UINT message, WPARAM wParam, LPARAM lParam);
 
   winrt::handle create_debug_window();
+
+  //Number of heap allocations made by the current thread, only counted in debug builds
+  size_t allocation_count();
+
+  //Whether allocations are counted at all in this build
+  bool is_counting_allocations();
+
+  //Suspends allocation counting on the current thread, for calls into APIs which allocate internally
+  struct allocation_exemption
+  {
+  private:
+    bool _wasCounting;
+
+  public:
+    allocation_exemption();
+    ~allocation_exemption();
+
+    allocation_exemption(const allocation_exemption&) = delete;
+    allocation_exemption& operator=(const allocation_exemption&) = delete;
+  };
+
+  //Reports allocations the current thread makes between begin_frame and end_frame once the warm-up frames have passed.
+  //Frame loops of the app only log them to the debugger, harnesses check the returned count.
+  struct allocation_monitor
+  {
+  private:
+    uint32_t _warmupFrames;
+    size_t _allocationCount = 0u;
+
+  public:
+    allocation_monitor(uint32_t warmupFrames = 16u);
+
+    void begin_frame();
+
+    //Returns the number of allocations made during the frame, zero during warm-up
+    size_t end_frame();
+  };
 }
\ No newline at end of file
@@ -0,0 +1,98 @@
+#include "pch.h"
+#include "Metrics.h"
+#include "Tracing.h"
+
+using namespace std;
+using namespace std::chrono;
+
+namespace AxoLight::Infrastructure
+{
+  uint32_t latency_histogram::bucket_index(uint64_t value)
+  {
+    if (value < exact_range) return uint32_t(value);
+
+    unsigned long magnitude;
+    _BitScanReverse64(&magnitude, value);
+
+    auto shift = magnitude - sub_bucket_bits;
+    auto subBucket = uint32_t(value >> shift) & ((1u << sub_bucket_bits) - 1u);
+    return exact_range + (magnitude - 5u) * (1u << sub_bucket_bits) + subBucket;
+  }
+
+  //Upper end of the values falling into the bucket
+  uint64_t latency_histogram::bucket_value(uint32_t index)
+  {
+    if (index < exact_range) return index;
+
+    auto magnitude = (index - exact_range) / (1u << sub_bucket_bits) + 5u;
+    auto subBucket = (index - exact_range) % (1u << sub_bucket_bits);
+    auto shift = magnitude - sub_bucket_bits;
+    return ((uint64_t((1u << sub_bucket_bits) + subBucket + 1u)) << shift) - 1u;
+  }
+
+  void latency_histogram::record(std::chrono::steady_clock::duration duration)
+  {
+    auto value = uint64_t(max<int64_t>(duration_cast<microseconds>(duration).count(), 0));
+
+    _buckets[bucket_index(value)].fetch_add(1u, memory_order_relaxed);
+    _count.fetch_add(1u, memory_order_relaxed);
+    _sum.fetch_add(value, memory_order_relaxed);
+
+    auto maximum = _max.load(memory_order_relaxed);
+    while (value > maximum && !_max.compare_exchange_weak(maximum, value, memory_order_relaxed));
+  }
+
+  latency_snapshot latency_histogram::snapshot() const
+  {
+    //The buckets are read one by one, so a snapshot taken during recording may be off by the samples recorded meanwhile
+    array<uint64_t, bucket_count> buckets;
+    uint64_t count = 0u;
+    for (auto i = 0u; i < bucket_count; i++)
+    {
+      buckets[i] = _buckets[i].load(memory_order_relaxed);
+      count += buckets[i];
+    }
+
+    latency_snapshot result{};
+    result.count = count;
+    if (count == 0u) return result;
+
+    auto maximum = _max.load(memory_order_relaxed);
+    auto percentile = [&](double fraction) {
+      auto rank = uint64_t(ceil(fraction * count));
+      uint64_t seen = 0u;
+      for (auto i = 0u; i < bucket_count; i++)
+      {
+        seen += buckets[i];
+        if (seen >= rank) return microseconds(min(bucket_value(i), maximum));
+      }
+      return microseconds(maximum);
+    };
+
+    result.mean = microseconds(_sum.load(memory_order_relaxed) / max<uint64_t>(_count.load(memory_order_relaxed), 1u));
+    result.p50 = percentile(0.5);
+    result.p99 = percentile(0.99);
+    result.max = microseconds(maximum);
+    return result;
+  }
+
+  latency_scope::latency_scope(latency_histogram& histogram, const char* traceName, uint64_t frame) :
+    _histogram(histogram),
+    _traceName(traceName),
+    _frame(frame),
+    _start(steady_clock::now())
+  { }
+
+  latency_scope::~latency_scope()
+  {
+    auto end = steady_clock::now();
+    _histogram.record(end - _start);
+    if (_traceName) trace_buffer::record(_traceName, _start, end, _frame);
+  }
+
+  void print_latency(const char* name, const latency_snapshot& snapshot)
+  {
+    printf("  %-16s %8llu samples, mean %7.2f ms, p50 %7.2f ms, p99 %7.2f ms, max %7.2f ms\n", name, snapshot.count,
+      snapshot.mean.count() / 1000., snapshot.p50.count() / 1000., snapshot.p99.count() / 1000., snapshot.max.count() / 1000.);
+  }
+}
\ No newline at end of file
@@ -0,0 +1,53 @@
+#pragma once
+#include "pch.h"
+
+namespace AxoLight::Infrastructure
+{
+  struct latency_snapshot
+  {
+    uint64_t count;
+    std::chrono::microseconds mean, p50, p99, max;
+  };
+
+  //Log-linear histogram of durations in microseconds, exact below 32 us and within 1/16 above.
+  //Recording is wait-free, so any thread can feed it while another takes snapshots.
+  struct latency_histogram
+  {
+  private:
+    static const uint32_t exact_range = 32u;
+    static const uint32_t sub_bucket_bits = 4u;
+    static const uint32_t bucket_count = exact_range + (64u - 5u) * (1u << sub_bucket_bits);
+
+    std::array<std::atomic<uint64_t>, bucket_count> _buckets{};
+    std::atomic<uint64_t> _count = 0u;
+    std::atomic<uint64_t> _sum = 0u;
+    std::atomic<uint64_t> _max = 0u;
+
+    static uint32_t bucket_index(uint64_t value);
+    static uint64_t bucket_value(uint32_t index);
+
+  public:
+    void record(std::chrono::steady_clock::duration duration);
+
+    latency_snapshot snapshot() const;
+  };
+
+  //Records the time from its creation to its destruction, and a trace span if a name is given and tracing is enabled
+  struct latency_scope
+  {
+  private:
+    latency_histogram& _histogram;
+    const char* _traceName;
+    uint64_t _frame;
+    std::chrono::steady_clock::time_point _start;
+
+  public:
+    latency_scope(latency_histogram& histogram, const char* traceName = nullptr, uint64_t frame = 0u);
+    ~latency_scope();
+
+    latency_scope(const latency_scope&) = delete;
+    latency_scope& operator=(const latency_scope&) = delete;
+  };
+
+  void print_latency(const char* name, const latency_snapshot& snapshot);
+}
\ No newline at end of file
@@ -0,0 +1,184 @@
+#include "pch.h"
+#include "NetworkTransports.h"
+#include "AdaLightEncoder.h"
+
+using namespace std;
+
+using namespace winrt;
+
+namespace AxoLight::Lighting
+{
+  void write_uint16(uint8_t* target, uint16_t value)
+  {
+    target[0] = uint8_t(value >> 8);
+    target[1] = uint8_t(value);
+  }
+
+  void write_uint32(uint8_t* target, uint32_t value)
+  {
+    write_uint16(target, uint16_t(value >> 16));
+    write_uint16(target + 2, uint16_t(value));
+  }
+
+  udp_transport::udp_transport(const std::wstring& address, uint16_t port, size_t headerSize, size_t payloadSize) :
+    _payloadSize(payloadSize),
+    _headerSize(headerSize)
+  {
+    WSADATA data;
+    _isStarted = WSAStartup(MAKEWORD(2, 2), &data) == 0;
+    if (!_isStarted) return;
+
+    ADDRINFOW hints = {};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_DGRAM;
+    hints.ai_protocol = IPPROTO_UDP;
+
+    ADDRINFOW* addresses = nullptr;
+    if (GetAddrInfoW(address.c_str(), to_wstring(port).c_str(), &hints, &addresses) != 0) return;
+
+    for (auto item = addresses; item && _socket == INVALID_SOCKET; item = item->ai_next)
+    {
+      _socket = socket(item->ai_family, item->ai_socktype, item->ai_protocol);
+      if (_socket == INVALID_SOCKET) continue;
+
+      if (connect(_socket, item->ai_addr, int(item->ai_addrlen)) != 0)
+      {
+        closesocket(_socket);
+        _socket = INVALID_SOCKET;
+      }
+    }
+    FreeAddrInfoW(addresses);
+
+#ifdef UDP_SEND_MSG_SIZE
+    //Every packet but the last has the same size, so the whole frame can go down in one send
+    auto segmentSize = DWORD(_headerSize + _payloadSize);
+    _isSegmenting = _socket != INVALID_SOCKET && setsockopt(_socket, IPPROTO_UDP, UDP_SEND_MSG_SIZE, (const char*)&segmentSize, sizeof(segmentSize)) == 0;
+#endif
+  }
+
+  udp_transport::~udp_transport()
+  {
+    if (_socket != INVALID_SOCKET) closesocket(_socket);
+
+    //Winsock is reference counted per process, only a successful startup may be balanced
+    if (_isStarted) WSACleanup();
+  }
+
+  bool udp_transport::is_open() const
+  {
+    return _socket != INVALID_SOCKET;
+  }
+
+  void udp_transport::write(const uint8_t* data, size_t size)
+  {
+    //The colors are sent without the AdaLight header
+    auto colors = data + adalight_encoder::header_size;
+    auto colorSize = size - adalight_encoder::header_size;
+
+    auto packetCount = max((colorSize + _payloadSize - 1) / _payloadSize, size_t(1));
+    auto packetSize = _headerSize + _payloadSize;
+    _packets.resize(packetCount * packetSize);
+
+    size_t sendSize = 0u;
+    for (size_t i = 0u; i < packetCount; i++)
+    {
+      auto offset = i * _payloadSize;
+      auto payloadSize = min(_payloadSize, colorSize - offset);
+      auto packet = _packets.data() + i * packetSize;
+
+      write_header(packet, i, offset, payloadSize, i + 1 == packetCount);
+      memcpy(packet + _headerSize, colors + offset, payloadSize);
+      sendSize = i * packetSize + _headerSize + payloadSize;
+    }
+
+    if (_isSegmenting)
+    {
+      _isSent = send(_socket, (const char*)_packets.data(), int(sendSize), 0) == int(sendSize);
+    }
+    else
+    {
+      _isSent = true;
+      for (size_t i = 0u; i < packetCount; i++)
+      {
+        auto length = int(i + 1 < packetCount ? packetSize : sendSize - i * packetSize);
+        _isSent &= send(_socket, (const char*)_packets.data() + i * packetSize, length, 0) == length;
+      }
+    }
+  }
+
+  bool udp_transport::wait()
+  {
+    return _isSent;
+  }
+
+  std::chrono::steady_clock::duration udp_transport::wire_time(size_t /*size*/) const
+  {
+    return std::chrono::steady_clock::duration::zero();
+  }
+
+  bool udp_transport::is_segmenting() const
+  {
+    return _isSegmenting;
+  }
+
+  ddp_transport::ddp_transport(const std::wstring& address, uint16_t port) :
+    udp_transport(address, port ? port : default_port, header_size, payload_size)
+  { }
+
+  void ddp_transport::write_header(uint8_t* packet, size_t index, size_t offset, size_t size, bool isLast)
+  {
+    //Sequence numbers run from 1 to 15 and change per frame, zero would disable them
+    if (index == 0u) _sequence = uint8_t(_sequence % 15u + 1u);
+
+    packet[0] = uint8_t(0x40 | (isLast ? 0x01 : 0x00)); //Version 1, push
+    packet[1] = _sequence;
+    packet[2] = 0x0b; //RGB, 8 bits per channel
+    packet[3] = 0x01; //Default output
+    write_uint32(packet + 4, uint32_t(offset));
+    write_uint16(packet + 8, uint16_t(size));
+  }
+
+  e131_transport::e131_transport(const std::wstring& address, uint16_t port, uint16_t universe) :
+    udp_transport(address, port ? port : default_port, header_size, payload_size),
+    _universe(universe)
+  {
+    random_device random;
+    for (auto& value : _cid)
+    {
+      value = uint8_t(random());
+    }
+  }
+
+  void e131_transport::write_header(uint8_t* packet, size_t index, size_t /*offset*/, size_t size, bool /*isLast*/)
+  {
+    if (index == 0u) _sequence++;
+
+    const array<uint8_t, 12> packetIdentifier = { 'A', 'S', 'C', '-', 'E', '1', '.', '1', '7', 0, 0, 0 };
+    const char sourceName[] = "AxoLight";
+
+    auto packetSize = header_size + size;
+    memset(packet, 0, header_size);
+
+    //Root layer
+    write_uint16(packet, 0x0010);
+    copy(packetIdentifier.begin(), packetIdentifier.end(), packet + 4);
+    write_uint16(packet + 16, uint16_t(0x7000 | (packetSize - 16)));
+    write_uint32(packet + 18, 0x00000004);
+    copy(_cid.begin(), _cid.end(), packet + 22);
+
+    //Framing layer
+    write_uint16(packet + 38, uint16_t(0x7000 | (packetSize - 38)));
+    write_uint32(packet + 40, 0x00000002);
+    memcpy(packet + 44, sourceName, sizeof(sourceName));
+    packet[108] = 100; //Priority
+    packet[111] = _sequence;
+    write_uint16(packet + 113, uint16_t(_universe + index));
+
+    //DMP layer, the DMX start code is followed by the channels
+    write_uint16(packet + 115, uint16_t(0x7000 | (packetSize - 115)));
+    packet[117] = 0x02;
+    packet[118] = 0xa1;
+    write_uint16(packet + 121, 0x0001);
+    write_uint16(packet + 123, uint16_t(size + 1));
+  }
+}
\ No newline at end of file
@@ -0,0 +1,76 @@
+#pragma once
+#include "pch.h"
+#include "SerialTransports.h"
+
+namespace AxoLight::Lighting
+{
+  //Sends the colors of encoded AdaLight frames to a network controller such as WLED, split into equally sized packets behind a protocol header.
+  //All packets of a frame are submitted with a single send, which the stack segments into datagrams if it supports UDP send offload.
+  struct udp_transport : public serial_transport
+  {
+  private:
+    bool _isStarted = false;
+    SOCKET _socket = INVALID_SOCKET;
+    size_t _payloadSize;
+    size_t _headerSize;
+    bool _isSegmenting = false;
+    bool _isSent = true;
+
+  protected:
+    std::vector<uint8_t> _packets;
+
+    udp_transport(const std::wstring& address, uint16_t port, size_t headerSize, size_t payloadSize);
+
+    //Writes the header of a packet in front of its payload, which is already in place
+    virtual void write_header(uint8_t* packet, size_t index, size_t offset, size_t size, bool isLast) = 0;
+
+  public:
+    ~udp_transport();
+
+    udp_transport(const udp_transport&) = delete;
+    udp_transport& operator=(const udp_transport&) = delete;
+
+    virtual bool is_open() const override;
+    virtual void write(const uint8_t* data, size_t size) override;
+    virtual bool wait() override;
+    virtual std::chrono::steady_clock::duration wire_time(size_t size) const override;
+
+    bool is_segmenting() const;
+  };
+
+  //Distributed Display Protocol, the colors are sent as one stream with the push flag on its last packet
+  struct ddp_transport : public udp_transport
+  {
+  private:
+    uint8_t _sequence = 0u;
+
+  protected:
+    virtual void write_header(uint8_t* packet, size_t index, size_t offset, size_t size, bool isLast) override;
+
+  public:
+    static const uint16_t default_port = 4048u;
+    static const size_t header_size = 10u;
+    static const size_t payload_size = 1440u;
+
+    ddp_transport(const std::wstring& address, uint16_t port);
+  };
+
+  //E1.31 (sACN) sent by unicast, every universe carries 170 lights
+  struct e131_transport : public udp_transport
+  {
+  private:
+    uint16_t _universe;
+    uint8_t _sequence = 0u;
+    std::array<uint8_t, 16> _cid;
+
+  protected:
+    virtual void write_header(uint8_t* packet, size_t index, size_t offset, size_t size, bool isLast) override;
+
+  public:
+    static const uint16_t default_port = 5568u;
+    static const size_t header_size = 126u;
+    static const size_t payload_size = 510u;
+
+    e131_transport(const std::wstring& address, uint16_t port, uint16_t universe);
+  };
+}
\ No newline at end of file
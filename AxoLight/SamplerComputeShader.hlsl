@@ -1,103 +1,14 @@
-SamplerState _sampler : register(s0);
 Texture2D _texture : register(t0);
 StructuredBuffer<float4> _sampleRects : register(t1);
+Texture3D<float4> _transferLut : register(t2);
 RWStructuredBuffer<uint4> _sumTexture : register(u0);
 
 groupshared float4 _sampleRect;
 groupshared float2 _sampleStep;
 groupshared uint4 _sum = uint4(0, 0, 0, 0);
-            
-float3 rgb_to_hsl(float3 rgb)
-{
-  float3 result;
-
-  float maximum = max(max(rgb.x, rgb.y), rgb.z);
-  float minimum = min(min(rgb.x, rgb.y), rgb.z);
-
-  float diff = maximum - minimum;
-  result.z = (maximum + minimum) / 2.f;
-  if (abs(diff) < 0.00001f)
-  {
-    result.y = 0.f;
-    result.x = 0.f;
-  }
-  else
-  {
-    if (result.z <= 0.5f)
-    {
-      result.y = diff / (maximum + minimum);
-    }
-    else
-    {
-      result.y = diff / (2.f - maximum - minimum);
-    }
-
-    float3 dist = (maximum - rgb) / diff;
-
-    if (rgb.x == maximum)
-    {
-      result.x = dist.z - dist.y;
-    }
-    else if (rgb.y == maximum)
-    {
-      result.x = 2.f + dist.x - dist.z;
-    }
-    else
-    {
-      result.x = 4.f + dist.y - dist.x;
-    }
-
-    result.x *= 60.f;
-    if (result.x < 0.f) result.x += 360.f;
-  }
-
-  return result;
-}
-
-float qqh_to_rgb(float q1, float q2, float hue)
-{
-  if (hue > 360.f) hue -= 360.f;
-  else if (hue < 0.f) hue += 360.f;
 
-  if (hue < 60.f) return q1 + (q2 - q1) * hue / 60.f;
-  if (hue < 180.f) return q2;
-  if (hue < 240.f) return q1 + (q2 - q1) * (240.f - hue) / 60.f;
-  return q1;
-}
-
-float3 hsl_to_rgb(float3 hsl)
-{
-  float p2;
-  if (hsl.z <= 0.5f) p2 = hsl.z * (1 + hsl.y);
-  else p2 = hsl.z + hsl.y - hsl.z * hsl.y;
-
-  float p1 = 2.f * hsl.z - p2;
-  float3 rgb;
-  if (hsl.y == 0)
-  {
-    rgb = hsl.z;
-  }
-  else
-  {
-    rgb = float3(
-      qqh_to_rgb(p1, p2, hsl.x + 120.f),
-      qqh_to_rgb(p1, p2, hsl.x),
-      qqh_to_rgb(p1, p2, hsl.x - 120.f)
-      );
-  }
-
-  return rgb;
-}
-#define PI 3.141592653589793
-
-float ease(float t, float p0, float p1)
-{
-  if (t < p0) return 0;
-  if (t > p1) return 1;
-
-  float x = 2 * ((t - p0) / (p1 - p0) - 0.5);
-  return 0.5 * (sin(x * 2 / PI) + 1);
-}
+//Must match transfer_lut::size
+#define TRANSFER_LUT_SIZE 52
 
 #define SAMPLE_POINTS 32
 
@@ -116,18 +27,17 @@ void main(
 
   float2 samplePoint = float2(0, 1) + float2(1, -1) * (_sampleRect.xw + _sampleStep * threadId.xy);
 
-  float4 color = _texture.SampleLevel(_sampler, samplePoint, 0);
-  if (any(color.rgb))
-  {
-    float3 hsl = rgb_to_hsl(color.rgb);
+  //Nearest pixel and nearest lattice point, as cpu_sampler reads them
+  uint2 size;
+  _texture.GetDimensions(size.x, size.y);
+  int2 pixel = clamp(int2(samplePoint * size), 0, int2(size) - 1);
+  float4 color = _texture.Load(int3(pixel, 0));
 
-    float factor = 255 * ease(hsl.z, 0.1, 0.8);
-    hsl.z = ease(hsl.z, 0, 0.8);
-    hsl.y = ease(hsl.y, 0.2, 1);
-    
-    color.rgb = hsl_to_rgb(hsl);
-    
-    uint4 value = uint4(255 * color.r, 255 * color.g, 255 * color.b, 1) * factor;
+  //The table holds the weighted color and the weight scaled to 16 bits, blue runs along x
+  int3 lattice = int3(color.bgr * (TRANSFER_LUT_SIZE - 1) + 0.5);
+  uint4 value = uint4(_transferLut.Load(int4(lattice, 0)) * 65535 + 0.5);
+  if (value.w > 0)
+  {
     InterlockedAdd(_sum.x, value.x);
     InterlockedAdd(_sum.y, value.y);
     InterlockedAdd(_sum.z, value.z);
@@ -0,0 +1,286 @@
+#include "pch.h"
+#include "Sampling.h"
+#include "Simd.h"
+
+using namespace AxoLight::Display;
+
+using namespace std;
+using namespace winrt::Windows::Foundation::Numerics;
+
+namespace AxoLight::Sampling
+{
+  //Returns the range of cells overlapping [min, max], padded by one cell to tolerate the rounding of the accumulated cell edges
+  pair<size_t, size_t> cell_range(float min, float max, float step, size_t count)
+  {
+    auto first = int64_t(floor(min / step)) - 1;
+    auto last = int64_t(ceil(max / step)) + 1;
+    return { size_t(clamp<int64_t>(first, 0, count)), size_t(clamp<int64_t>(last, 0, count)) };
+  }
+
+  SamplingDescription SamplingDescription::Create(const DisplaySettings& settings, size_t verticalDivisions)
+  {
+    auto horizontalDivisions = size_t(verticalDivisions * settings.AspectRatio);
+
+    //
+    vector<rect> lightRects;
+    lightRects.reserve(settings.SamplePoints.size());
+    auto sampleOffset = settings.SampleSize / float2(2.f, -2.f);
+    for (auto& samplePoint : settings.SamplePoints)
+    {
+      lightRects.push_back({ samplePoint - sampleOffset, samplePoint + sampleOffset });
+    }
+
+    //
+    float2 step{ 1.f / horizontalDivisions, 1.f / verticalDivisions };
+    vector<vector<uint32_t>> cellLights(verticalDivisions * horizontalDivisions);
+
+    for (size_t lightIndex = 0u; lightIndex < lightRects.size(); lightIndex++)
+    {
+      auto& lightRect = lightRects[lightIndex];
+      auto [left, right] = cell_range(lightRect.left, lightRect.right, step.x, horizontalDivisions);
+      auto [bottom, top] = cell_range(lightRect.bottom, lightRect.top, step.y, verticalDivisions);
+
+      for (auto y = bottom; y < top; y++)
+      {
+        for (auto x = left; x < right; x++)
+        {
+          cellLights[y * horizontalDivisions + x].push_back(uint32_t(lightIndex));
+        }
+      }
+    }
+
+    //
+    vector<vector<pair<uint32_t, float>>> lightsDisplayRectFactors(settings.SamplePoints.size());
+
+    vector<rect> displayRects;
+    displayRects.reserve(verticalDivisions * horizontalDivisions);
+
+    rect displayRect{ step.y, 0, 0, step.x };
+    for (size_t y = 0u; y < verticalDivisions; y++)
+    {
+      displayRect.left = 0;
+      displayRect.right = step.x;
+
+      for (size_t x = 0u; x < horizontalDivisions; x++)
+      {
+        bool isUsed = false;
+        for (auto lightIndex : cellLights[y * horizontalDivisions + x])
+        {
+          auto& sampleRect = lightRects[lightIndex];
+          if (sampleRect.intersects(displayRect))
+          {
+            isUsed = true;
+
+            auto weight = 1.f - length((displayRect.center() - sampleRect.center()) / 2.f / settings.SampleSize);
+            lightsDisplayRectFactors[lightIndex].push_back({ uint32_t(displayRects.size()), weight });
+          }
+        }
+
+        if (isUsed)
+        {
+          displayRects.push_back(displayRect);
+        }
+
+        displayRect.left += step.x;
+        displayRect.right += step.x;
+      }
+
+      displayRect.top += step.y;
+      displayRect.bottom += step.y;
+    }
+
+    //
+    for (auto& lightDisplayRectFactors : lightsDisplayRectFactors)
+    {
+      auto totalWeight = 0.f;
+      for (auto& displayRectFactor : lightDisplayRectFactors)
+      {
+        totalWeight += displayRectFactor.second;
+      }
+
+      for (auto& displayRectFactor : lightDisplayRectFactors)
+      {
+        displayRectFactor.second /= totalWeight;
+      }
+    }
+
+    //
+    auto rectFactors = sparse_matrix::from_rows(lightsDisplayRectFactors);
+    auto rectLights = rectFactors.transpose(displayRects.size());
+
+    return { displayRects, rectFactors, rectLights };
+  }
+
+  sparse_matrix sparse_matrix::from_rows(const std::vector<std::vector<std::pair<uint32_t, float>>>& rows)
+  {
+    sparse_matrix result;
+    result.offsets.reserve(rows.size() + 1);
+    result.offsets.push_back(0u);
+
+    for (auto& row : rows)
+    {
+      for (auto& [column, value] : row)
+      {
+        result.columns.push_back(column);
+        result.values.push_back(value);
+      }
+      result.offsets.push_back(uint32_t(result.columns.size()));
+    }
+
+    return result;
+  }
+
+  sparse_matrix sparse_matrix::transpose(size_t columnCount) const
+  {
+    sparse_matrix result;
+    result.offsets.assign(columnCount + 1, 0u);
+    result.columns.resize(columns.size());
+    result.values.resize(values.size());
+
+    for (auto column : columns)
+    {
+      result.offsets[column + 1]++;
+    }
+    partial_sum(result.offsets.begin(), result.offsets.end(), result.offsets.begin());
+
+    vector<uint32_t> positions(result.offsets.begin(), result.offsets.end() - 1);
+    for (uint32_t row = 0u; row < rows(); row++)
+    {
+      for (auto i = offsets[row]; i < offsets[row + 1]; i++)
+      {
+        auto position = positions[columns[i]]++;
+        result.columns[position] = row;
+        result.values[position] = values[i];
+      }
+    }
+
+    return result;
+  }
+
+  RECT to_pixel_box(const rect& rect, uint32_t width, uint32_t height)
+  {
+    auto toColumn = [&](float x) { return clamp(LONG(x * width), 0l, LONG(width)); };
+    auto toRow = [&](float y) { return clamp(LONG((1.f - y) * height), 0l, LONG(height)); };
+
+    return {
+      max(toColumn(rect.left) - 1, 0l),
+      max(toRow(rect.top) - 1, 0l),
+      min(toColumn(rect.right) + 2, LONG(width)),
+      min(toRow(rect.bottom) + 2, LONG(height))
+    };
+  }
+
+  std::vector<RECT> get_border_bands(const std::vector<RECT>& boxes, uint32_t width, uint32_t height, LONG alignment)
+  {
+    //Left, top, right and bottom
+    array<RECT, 4> bands;
+    array<bool, 4> isUsed = {};
+    for (auto& box : boxes)
+    {
+      if (box.left >= box.right || box.top >= box.bottom) continue;
+
+      auto x = (box.left + box.right) / 2;
+      auto y = (box.top + box.bottom) / 2;
+      array<LONG, 4> distances = { x, y, LONG(width) - x, LONG(height) - y };
+      auto edge = size_t(min_element(distances.begin(), distances.end()) - distances.begin());
+
+      auto& band = bands[edge];
+      if (!isUsed[edge])
+      {
+        band = box;
+        isUsed[edge] = true;
+      }
+      else
+      {
+        band = { min(band.left, box.left), min(band.top, box.top), max(band.right, box.right), max(band.bottom, box.bottom) };
+      }
+    }
+
+    vector<RECT> result;
+    for (size_t i = 0u; i < bands.size(); i++)
+    {
+      if (!isUsed[i]) continue;
+
+      auto& band = bands[i];
+      result.push_back({
+        band.left / alignment * alignment,
+        band.top / alignment * alignment,
+        min((band.right + alignment - 1) / alignment * alignment, LONG(width)),
+        min((band.bottom + alignment - 1) / alignment * alignment, LONG(height))
+        });
+    }
+    return result;
+  }
+
+  Colors::rgb to_rgb(__m128 color)
+  {
+    color = _mm_min_ps(_mm_max_ps(color, _mm_setzero_ps()), _mm_set1_ps(255.f));
+
+    alignas(16) array<int32_t, 4> channels;
+    _mm_store_si128(reinterpret_cast<__m128i*>(channels.data()), _mm_cvttps_epi32(color));
+    return { uint8_t(channels[0]), uint8_t(channels[1]), uint8_t(channels[2]) };
+  }
+
+  __m128 load_sum(const array<uint32_t, 4>& sum)
+  {
+    return _mm_cvtepi32_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(sum.data())));
+  }
+
+  Colors::rgb mix_light_sse2(const sparse_matrix& rectFactors, const array<uint32_t, 4>* sums, uint32_t light)
+  {
+    auto color = _mm_setzero_ps();
+    for (auto i = rectFactors.offsets[light]; i < rectFactors.offsets[light + 1]; i++)
+    {
+      color = _mm_add_ps(color, _mm_mul_ps(load_sum(sums[rectFactors.columns[i]]), _mm_set1_ps(rectFactors.values[i])));
+    }
+
+    return to_rgb(color);
+  }
+
+  //Processes two non-zeros per iteration, one in each 128-bit lane
+  Colors::rgb mix_light_avx2(const sparse_matrix& rectFactors, const array<uint32_t, 4>* sums, uint32_t light)
+  {
+    auto begin = rectFactors.offsets[light];
+    auto end = rectFactors.offsets[light + 1];
+    auto columns = rectFactors.columns.data();
+    auto values = rectFactors.values.data();
+
+    auto accumulator = _mm256_setzero_ps();
+    auto i = begin;
+    for (; i + 2 <= end; i += 2)
+    {
+      auto pair = _mm256_inserti128_si256(
+        _mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(sums[columns[i]].data()))),
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(sums[columns[i + 1]].data())), 1);
+      auto weights = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_set1_ps(values[i])), _mm_set1_ps(values[i + 1]), 1);
+
+      accumulator = _mm256_add_ps(accumulator, _mm256_mul_ps(_mm256_cvtepi32_ps(pair), weights));
+    }
+
+    auto color = _mm_add_ps(_mm256_castps256_ps128(accumulator), _mm256_extractf128_ps(accumulator, 1));
+    if (i < end)
+    {
+      color = _mm_add_ps(color, _mm_mul_ps(load_sum(sums[columns[i]]), _mm_set1_ps(values[i])));
+    }
+
+    return to_rgb(color);
+  }
+
+  void mix_lights(const sparse_matrix& rectFactors, const std::vector<std::array<uint32_t, 4>>& sums, const std::vector<uint32_t>& lights, std::vector<Colors::rgb>& colors)
+  {
+    if (Simd::has_avx2())
+    {
+      for (auto light : lights)
+      {
+        colors[light] = mix_light_avx2(rectFactors, sums.data(), light);
+      }
+    }
+    else
+    {
+      for (auto light : lights)
+      {
+        colors[light] = mix_light_sse2(rectFactors, sums.data(), light);
+      }
+    }
+  }
+}
\ No newline at end of file
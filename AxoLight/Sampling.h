@@ -0,0 +1,118 @@
+#pragma once
+#include "pch.h"
+#include "DisplaySettings.h"
+#include "Colors.h"
+
+namespace AxoLight::Sampling
+{
+  enum class SamplerMode
+  {
+    Gpu,
+    Cpu,
+    SummedArea
+  };
+
+  //Range of an input mapped onto 0..1 by a sine ease
+  struct EaseRange
+  {
+    float Start, End;
+  };
+
+  struct SamplingOptions
+  {
+    SamplerMode Mode = SamplerMode::Gpu;
+    bool IsIncremental = true;
+
+    //CPU modes only, samples a box filtered copy of the frame downscaled as far as the cell size allows
+    bool IsDownscaled = false;
+
+    //Transform applied to every sampled pixel in HSL space
+    EaseRange WeightRange = { 0.1f, 0.8f };
+    EaseRange LightnessRange = { 0.f, 0.8f };
+    EaseRange SaturationRange = { 0.2f, 1.f };
+  };
+
+  union rect
+  {
+    struct {
+      float left, top, right, bottom;
+    };
+    struct {
+      winrt::Windows::Foundation::Numerics::float2 top_left, bottom_right;
+    };
+
+    rect(float top, float left, float bottom, float right) :
+      left(left),
+      top(top),
+      right(right),
+      bottom(bottom)
+    { }
+
+    rect(winrt::Windows::Foundation::Numerics::float2 topLeft, winrt::Windows::Foundation::Numerics::float2 bottomRight) :
+      left(topLeft.x),
+      top(topLeft.y),
+      right(bottomRight.x),
+      bottom(bottomRight.y)
+    { }
+
+    bool intersects(const rect& other) const
+    {
+      return (left < other.right && right > other.left && top > other.bottom && bottom < other.top);
+    }
+
+    winrt::Windows::Foundation::Numerics::float2 center() const
+    {
+      return (top_left + bottom_right) / 2.f;
+    }
+  };
+
+  //Compressed sparse row matrix, row i is stored in columns and values at [offsets[i], offsets[i + 1])
+  struct sparse_matrix
+  {
+    std::vector<uint32_t> offsets;
+    std::vector<uint32_t> columns;
+    std::vector<float> values;
+
+    size_t rows() const
+    {
+      return offsets.empty() ? 0u : offsets.size() - 1;
+    }
+
+    static sparse_matrix from_rows(const std::vector<std::vector<std::pair<uint32_t, float>>>& rows);
+
+    sparse_matrix transpose(size_t columnCount) const;
+  };
+
+  struct SamplingDescription
+  {
+    std::vector<rect> Rects;
+    sparse_matrix RectFactors;
+    sparse_matrix RectLights;
+
+    static SamplingDescription Create(const Display::DisplaySettings& settings, size_t verticalDivisions = 16);
+  };
+
+  //Pixels a rect can be sampled from, padded by one pixel to cover the rounding of every sampler
+  RECT to_pixel_box(const rect& rect, uint32_t width, uint32_t height);
+
+  //Bounding boxes of the boxes nearest to each edge of the frame, at most four.
+  //Lights sit on the edges of the screen, so the bands cover every box while leaving out the interior. Band edges inside the frame are multiples of the alignment.
+  std::vector<RECT> get_border_bands(const std::vector<RECT>& boxes, uint32_t width, uint32_t height, LONG alignment = 1);
+
+  //Computes the given lights as the weighted sum of the sampled rect colors
+  void mix_lights(const sparse_matrix& rectFactors, const std::vector<std::array<uint32_t, 4>>& sums, const std::vector<uint32_t>& lights, std::vector<Colors::rgb>& colors);
+
+  //A view of a B8G8R8A8 frame in CPU memory, rows are stride bytes apart
+  //If dirty_rects is set, only the pixels inside those have changed since the previous frame
+  struct frame_view
+  {
+    const uint8_t* data;
+    uint32_t width, height, stride;
+    const std::vector<RECT>* dirty_rects = nullptr;
+
+    const uint32_t* row(uint32_t y) const
+    {
+      return reinterpret_cast<const uint32_t*>(data + size_t(y) * stride);
+    }
+  };
+}
@@ -0,0 +1,149 @@
+#include "pch.h"
+#include "SerialTransports.h"
+#include "AdaLightController.h"
+#include "NetworkTransports.h"
+
+using namespace std;
+
+using namespace winrt;
+using namespace winrt::Windows::Devices::Enumeration;
+using namespace winrt::Windows::Devices::SerialCommunication;
+using namespace winrt::Windows::Storage::Streams;
+
+namespace AxoLight::Lighting
+{
+  std::unique_ptr<serial_transport> serial_transport::create(const AdaLightOptions& options)
+  {
+    switch (options.Transport)
+    {
+    case SerialTransportType::UsbDevice:
+      return make_unique<winrt_serial_transport>(options.UsbVendorId, options.UsbProductId, options.DeviceIndex, options.BaudRate);
+    case SerialTransportType::Port:
+      return make_unique<win32_serial_transport>(options.PortName, options.BaudRate);
+    case SerialTransportType::Ddp:
+      return make_unique<ddp_transport>(options.Address, options.NetworkPort);
+    case SerialTransportType::E131:
+      return make_unique<e131_transport>(options.Address, options.NetworkPort, options.Universe);
+    default:
+      throw out_of_range("Invalid serial transport type!");
+    }
+  }
+
+  winrt_serial_transport::winrt_serial_transport(uint16_t usbVendorId, uint16_t usbProductId, uint32_t deviceIndex, uint32_t baudRate) :
+    _baudRate(baudRate)
+  {
+    auto deviceSelector = SerialDevice::GetDeviceSelectorFromUsbVidPid(usbVendorId, usbProductId);
+    auto deviceInformations = DeviceInformation::FindAllAsync(deviceSelector).get();
+    if (deviceInformations.Size() <= deviceIndex) return;
+
+    auto deviceInformation = deviceInformations.GetAt(deviceIndex);
+    auto serialDevice = SerialDevice::FromIdAsync(deviceInformation.Id()).get();
+    serialDevice.BaudRate(baudRate);
+    _writer = DataWriter(serialDevice.OutputStream());
+  }
+
+  bool winrt_serial_transport::is_open() const
+  {
+    return _writer != nullptr;
+  }
+
+  void winrt_serial_transport::write(const uint8_t* data, size_t size)
+  {
+    _writer.WriteBytes(array_view<const uint8_t>(data, data + size));
+    _store = _writer.StoreAsync();
+    _size = size;
+  }
+
+  bool winrt_serial_transport::wait()
+  {
+    if (!_store) return true;
+
+    try
+    {
+      auto storedSize = _store.get();
+      _store = nullptr;
+      return storedSize == _size;
+    }
+    catch (const hresult_error&)
+    {
+      _store = nullptr;
+      return false;
+    }
+  }
+
+  std::chrono::steady_clock::duration winrt_serial_transport::wire_time(size_t size) const
+  {
+    return AdaLightController::GetWireTime(size, _baudRate);
+  }
+
+  win32_serial_transport::win32_serial_transport(const std::wstring& portName, uint32_t baudRate) :
+    _writeEvent(CreateEvent(nullptr, true, false, nullptr)),
+    _baudRate(baudRate)
+  {
+    _port = file_handle(CreateFileW(portName.c_str(), GENERIC_WRITE, 0, nullptr, OPEN_EXISTING, FILE_FLAG_OVERLAPPED, nullptr));
+    if (!_port) return;
+
+    //Named pipes are used as loopback devices, only real ports have a line to configure
+    if (GetFileType(_port.get()) != FILE_TYPE_CHAR) return;
+
+    DCB dcb = {};
+    dcb.DCBlength = sizeof(DCB);
+    check_bool(GetCommState(_port.get(), &dcb));
+
+    dcb.BaudRate = baudRate;
+    dcb.ByteSize = 8;
+    dcb.Parity = NOPARITY;
+    dcb.StopBits = ONESTOPBIT;
+    dcb.fBinary = true;
+    dcb.fParity = false;
+    dcb.fOutxCtsFlow = false;
+    dcb.fOutxDsrFlow = false;
+    dcb.fDtrControl = DTR_CONTROL_ENABLE;
+    dcb.fRtsControl = RTS_CONTROL_ENABLE;
+    dcb.fOutX = false;
+    dcb.fInX = false;
+    check_bool(SetCommState(_port.get(), &dcb));
+
+    COMMTIMEOUTS timeouts = {};
+    check_bool(SetCommTimeouts(_port.get(), &timeouts));
+  }
+
+  win32_serial_transport::~win32_serial_transport()
+  {
+    if (_isWriting)
+    {
+      CancelIo(_port.get());
+      wait();
+    }
+  }
+
+  bool win32_serial_transport::is_open() const
+  {
+    return bool(_port);
+  }
+
+  void win32_serial_transport::write(const uint8_t* data, size_t size)
+  {
+    _overlapped = {};
+    _overlapped.hEvent = _writeEvent.get();
+    _size = size;
+
+    _isWriting = WriteFile(_port.get(), data, DWORD(size), nullptr, &_overlapped) || GetLastError() == ERROR_IO_PENDING;
+    _hasFailed = !_isWriting;
+  }
+
+  bool win32_serial_transport::wait()
+  {
+    if (!_isWriting) return !_hasFailed;
+
+    DWORD writtenSize = 0u;
+    auto isSuccessful = GetOverlappedResult(_port.get(), &_overlapped, &writtenSize, true) && writtenSize == _size;
+    _isWriting = false;
+    return isSuccessful;
+  }
+
+  std::chrono::steady_clock::duration win32_serial_transport::wire_time(size_t size) const
+  {
+    return AdaLightController::GetWireTime(size, _baudRate);
+  }
+}
\ No newline at end of file
@@ -0,0 +1,74 @@
+#pragma once
+#include "pch.h"
+
+namespace AxoLight::Lighting
+{
+  struct AdaLightOptions;
+
+  enum class SerialTransportType
+  {
+    UsbDevice,
+    Port,
+    Ddp,
+    E131
+  };
+
+  struct serial_transport
+  {
+  public:
+    virtual ~serial_transport() = default;
+
+    virtual bool is_open() const = 0;
+
+    //Starts sending the bytes and returns without waiting, the data must stay unchanged until wait returns
+    virtual void write(const uint8_t* data, size_t size) = 0;
+
+    //Waits until the last write is sent, returns false if it failed
+    virtual bool wait() = 0;
+
+    //Time the line needs to carry the given number of bytes, writes are paced by it
+    virtual std::chrono::steady_clock::duration wire_time(size_t size) const = 0;
+
+    static std::unique_ptr<serial_transport> create(const AdaLightOptions& options);
+  };
+
+  //Serial device found by its USB vendor and product id through WinRT, the index picks one of several identical boards
+  struct winrt_serial_transport : public serial_transport
+  {
+  private:
+    winrt::Windows::Storage::Streams::DataWriter _writer = nullptr;
+    winrt::Windows::Foundation::IAsyncOperation<uint32_t> _store = nullptr;
+    size_t _size = 0u;
+    uint32_t _baudRate;
+
+  public:
+    winrt_serial_transport(uint16_t usbVendorId, uint16_t usbProductId, uint32_t deviceIndex, uint32_t baudRate);
+
+    virtual bool is_open() const override;
+    virtual void write(const uint8_t* data, size_t size) override;
+    virtual bool wait() override;
+    virtual std::chrono::steady_clock::duration wire_time(size_t size) const override;
+  };
+
+  //COM port or named pipe opened by name with overlapped writes, the baud rate is passed to the driver as is
+  struct win32_serial_transport : public serial_transport
+  {
+  private:
+    winrt::file_handle _port;
+    winrt::handle _writeEvent;
+    OVERLAPPED _overlapped = {};
+    size_t _size = 0u;
+    bool _isWriting = false;
+    bool _hasFailed = false;
+    uint32_t _baudRate;
+
+  public:
+    win32_serial_transport(const std::wstring& portName, uint32_t baudRate);
+    ~win32_serial_transport();
+
+    virtual bool is_open() const override;
+    virtual void write(const uint8_t* data, size_t size) override;
+    virtual bool wait() override;
+    virtual std::chrono::steady_clock::duration wire_time(size_t size) const override;
+  };
+}
\ No newline at end of file
@@ -24,12 +24,37 @@ namespace AxoLight::Settings
         {
           if (property.Key() == L"controllerOptions")
           {
-            Parse(property.Value().GetObject(), settings.ControllerOptions);
+            Parse(property.Value(), settings.ControllerOptions);
           }
           else if (property.Key() == L"lightLayout")
           {
             Parse(property.Value().GetObject(), settings.LightLayout);
           }
+          else if (property.Key() == L"outputs")
+          {
+            for (const auto& item : property.Value().GetArray())
+            {
+              OutputSettings output{};
+              Parse(item.GetObject(), output);
+              settings.Outputs.push_back(output);
+            }
+          }
+          else if (property.Key() == L"samplingOptions")
+          {
+            Parse(property.Value().GetObject(), settings.SamplingOptions);
+          }
+          else if (property.Key() == L"frameSource")
+          {
+            Parse(property.Value().GetObject(), settings.FrameSourceOptions);
+          }
+          else if (property.Key() == L"temporalFilter")
+          {
+            Parse(property.Value().GetObject(), settings.TemporalFilterOptions);
+          }
+          else if (property.Key() == L"tracing")
+          {
+            Parse(property.Value().GetObject(), settings.TracingOptions);
+          }
         }
         catch (...)
         {
@@ -46,13 +71,28 @@ namespace AxoLight::Settings
     }
   }
 
+  const unordered_map<wstring, Lighting::SerialTransportType> _serialTransportTypeValues = {
+    { L"UsbDevice", Lighting::SerialTransportType::UsbDevice },
+    { L"Port", Lighting::SerialTransportType::Port },
+    { L"Ddp", Lighting::SerialTransportType::Ddp },
+    { L"E131", Lighting::SerialTransportType::E131 }
+  };
+
   void SettingsImporter::Parse(const JsonObject& json, Lighting::AdaLightOptions& options)
   {
     for (const auto& property : json)
     {
       try
       {
-        if (property.Key() == L"usbVendorId")
+        if (property.Key() == L"transport")
+        {
+          options.Transport = _serialTransportTypeValues.at(wstring(property.Value().GetString()));
+        }
+        else if (property.Key() == L"portName")
+        {
+          options.PortName = wstring(property.Value().GetString());
+        }
+        else if (property.Key() == L"usbVendorId")
         {
           options.UsbVendorId = (uint16_t)property.Value().GetNumber();
         }
@@ -60,13 +100,37 @@ namespace AxoLight::Settings
         {
           options.UsbProductId = (uint16_t)property.Value().GetNumber();
         }
+        else if (property.Key() == L"deviceIndex")
+        {
+          options.DeviceIndex = (uint32_t)property.Value().GetNumber();
+        }
         else if (property.Key() == L"baudRate")
         {
           options.BaudRate = (uint32_t)property.Value().GetNumber();
         }
-        else if (property.Key() == L"ledSyncDuration")
+        else if (property.Key() == L"latchMargin")
+        {
+          options.LatchMargin = duration_cast<microseconds>(duration<double, milli>(property.Value().GetNumber()));
+        }
+        else if (property.Key() == L"calibrationPath")
+        {
+          options.CalibrationPath = wstring(property.Value().GetString());
+        }
+        else if (property.Key() == L"address")
         {
-          options.LedSyncDuration = milliseconds((uint64_t)property.Value().GetNumber());
+          options.Address = wstring(property.Value().GetString());
+        }
+        else if (property.Key() == L"networkPort")
+        {
+          options.NetworkPort = (uint16_t)property.Value().GetNumber();
+        }
+        else if (property.Key() == L"universe")
+        {
+          options.Universe = (uint16_t)property.Value().GetNumber();
+        }
+        else if (property.Key() == L"lightCount")
+        {
+          options.LightCount = (uint16_t)property.Value().GetNumber();
         }
       }
       catch (...)
@@ -76,6 +140,26 @@ namespace AxoLight::Settings
     }
   }
 
+  void SettingsImporter::Parse(const IJsonValue& json, std::vector<Lighting::AdaLightOptions>& options)
+  {
+    options.clear();
+    if (json.ValueType() == JsonValueType::Array)
+    {
+      for (const auto& item : json.GetArray())
+      {
+        Lighting::AdaLightOptions controllerOptions{};
+        Parse(item.GetObject(), controllerOptions);
+        options.push_back(controllerOptions);
+      }
+    }
+    else
+    {
+      Lighting::AdaLightOptions controllerOptions{};
+      Parse(json.GetObject(), controllerOptions);
+      options.push_back(controllerOptions);
+    }
+  }
+
   void SettingsImporter::Parse(const winrt::Windows::Data::Json::JsonObject& json, Display::DisplaySize& displaySize)
   {
     for (const auto& property : json)
@@ -188,4 +272,212 @@ namespace AxoLight::Settings
       }
     }
   }
+
+  void SettingsImporter::Parse(const winrt::Windows::Data::Json::JsonObject& json, OutputSettings& outputSettings)
+  {
+    for (const auto& property : json)
+    {
+      try
+      {
+        if (property.Key() == L"outputName")
+        {
+          outputSettings.OutputName = wstring(property.Value().GetString());
+        }
+        else if (property.Key() == L"controllerOptions")
+        {
+          Parse(property.Value(), outputSettings.ControllerOptions);
+        }
+        else if (property.Key() == L"lightLayout")
+        {
+          Parse(property.Value().GetObject(), outputSettings.LightLayout);
+        }
+      }
+      catch (...)
+      {
+        wprintf(L"Failed to parse setting %s.", property.Key().c_str());
+      }
+    }
+  }
+
+  const unordered_map<wstring, Sampling::SamplerMode> _samplerModeValues = {
+    { L"Gpu", Sampling::SamplerMode::Gpu },
+    { L"Cpu", Sampling::SamplerMode::Cpu },
+    { L"SummedArea", Sampling::SamplerMode::SummedArea }
+  };
+
+  void SettingsImporter::Parse(const winrt::Windows::Data::Json::JsonObject& json, Sampling::EaseRange& easeRange)
+  {
+    for (const auto& property : json)
+    {
+      try
+      {
+        if (property.Key() == L"start")
+        {
+          easeRange.Start = (float)property.Value().GetNumber();
+        }
+        else if (property.Key() == L"end")
+        {
+          easeRange.End = (float)property.Value().GetNumber();
+        }
+      }
+      catch (...)
+      {
+        wprintf(L"Failed to parse setting %s.", property.Key().c_str());
+      }
+    }
+  }
+
+  void SettingsImporter::Parse(const winrt::Windows::Data::Json::JsonObject& json, Sampling::SamplingOptions& samplingOptions)
+  {
+    for (const auto& property : json)
+    {
+      try
+      {
+        if (property.Key() == L"mode")
+        {
+          samplingOptions.Mode = _samplerModeValues.at(wstring(property.Value().GetString()));
+        }
+        else if (property.Key() == L"isIncremental")
+        {
+          samplingOptions.IsIncremental = property.Value().GetBoolean();
+        }
+        else if (property.Key() == L"isDownscaled")
+        {
+          samplingOptions.IsDownscaled = property.Value().GetBoolean();
+        }
+        else if (property.Key() == L"weightRange")
+        {
+          Parse(property.Value().GetObject(), samplingOptions.WeightRange);
+        }
+        else if (property.Key() == L"lightnessRange")
+        {
+          Parse(property.Value().GetObject(), samplingOptions.LightnessRange);
+        }
+        else if (property.Key() == L"saturationRange")
+        {
+          Parse(property.Value().GetObject(), samplingOptions.SaturationRange);
+        }
+      }
+      catch (...)
+      {
+        wprintf(L"Failed to parse setting %s.", property.Key().c_str());
+      }
+    }
+  }
+
+  const unordered_map<wstring, Capture::FrameSourceType> _frameSourceTypeValues = {
+    { L"Desktop", Capture::FrameSourceType::Desktop },
+    { L"RawFile", Capture::FrameSourceType::RawFile },
+    { L"Synthetic", Capture::FrameSourceType::Synthetic }
+  };
+
+  const unordered_map<wstring, Capture::SyntheticPattern> _syntheticPatternValues = {
+    { L"Gradient", Capture::SyntheticPattern::Gradient },
+    { L"Flash", Capture::SyntheticPattern::Flash },
+    { L"MovingBars", Capture::SyntheticPattern::MovingBars }
+  };
+
+  void SettingsImporter::Parse(const winrt::Windows::Data::Json::JsonObject& json, Capture::FrameSourceOptions& frameSourceOptions)
+  {
+    for (const auto& property : json)
+    {
+      try
+      {
+        if (property.Key() == L"type")
+        {
+          frameSourceOptions.Type = _frameSourceTypeValues.at(wstring(property.Value().GetString()));
+        }
+        else if (property.Key() == L"path")
+        {
+          frameSourceOptions.Path = wstring(property.Value().GetString());
+        }
+        else if (property.Key() == L"pattern")
+        {
+          frameSourceOptions.Pattern = _syntheticPatternValues.at(wstring(property.Value().GetString()));
+        }
+        else if (property.Key() == L"width")
+        {
+          frameSourceOptions.Width = (uint32_t)property.Value().GetNumber();
+        }
+        else if (property.Key() == L"height")
+        {
+          frameSourceOptions.Height = (uint32_t)property.Value().GetNumber();
+        }
+        else if (property.Key() == L"frameRate")
+        {
+          frameSourceOptions.FrameRate = (uint32_t)property.Value().GetNumber();
+        }
+      }
+      catch (...)
+      {
+        wprintf(L"Failed to parse setting %s.", property.Key().c_str());
+      }
+    }
+  }
+
+  const unordered_map<wstring, Colors::TemporalFilterType> _temporalFilterTypeValues = {
+    { L"Exponential", Colors::TemporalFilterType::Exponential },
+    { L"CriticallyDamped", Colors::TemporalFilterType::CriticallyDamped },
+    { L"OneEuro", Colors::TemporalFilterType::OneEuro }
+  };
+
+  void SettingsImporter::Parse(const winrt::Windows::Data::Json::JsonObject& json, Colors::TemporalFilterOptions& temporalFilterOptions)
+  {
+    for (const auto& property : json)
+    {
+      try
+      {
+        if (property.Key() == L"type")
+        {
+          temporalFilterOptions.Type = _temporalFilterTypeValues.at(wstring(property.Value().GetString()));
+        }
+        else if (property.Key() == L"timeConstant")
+        {
+          temporalFilterOptions.TimeConstant = duration_cast<microseconds>(duration<double, milli>(property.Value().GetNumber()));
+        }
+        else if (property.Key() == L"minCutoff")
+        {
+          temporalFilterOptions.MinCutoff = (float)property.Value().GetNumber();
+        }
+        else if (property.Key() == L"beta")
+        {
+          temporalFilterOptions.Beta = (float)property.Value().GetNumber();
+        }
+        else if (property.Key() == L"derivativeCutoff")
+        {
+          temporalFilterOptions.DerivativeCutoff = (float)property.Value().GetNumber();
+        }
+      }
+      catch (...)
+      {
+        wprintf(L"Failed to parse setting %s.", property.Key().c_str());
+      }
+    }
+  }
+
+  void SettingsImporter::Parse(const winrt::Windows::Data::Json::JsonObject& json, Infrastructure::TracingOptions& tracingOptions)
+  {
+    for (const auto& property : json)
+    {
+      try
+      {
+        if (property.Key() == L"isEnabled")
+        {
+          tracingOptions.IsEnabled = property.Value().GetBoolean();
+        }
+        else if (property.Key() == L"capacity")
+        {
+          tracingOptions.Capacity = (uint32_t)property.Value().GetNumber();
+        }
+        else if (property.Key() == L"path")
+        {
+          tracingOptions.Path = wstring(property.Value().GetString());
+        }
+      }
+      catch (...)
+      {
+        wprintf(L"Failed to parse setting %s.", property.Key().c_str());
+      }
+    }
+  }
 }
\ No newline at end of file
@@ -1,13 +1,34 @@
 #pragma once
 #include "AdaLightController.h"
 #include "DisplaySettings.h"
+#include "FrameSources.h"
+#include "Sampling.h"
+#include "TemporalFilter.h"
+#include "Tracing.h"
 
 namespace AxoLight::Settings
 {
+  //A display lit by its own strip, the output name is the DXGI device name such as DISPLAY2
+  struct OutputSettings
+  {
+    std::wstring OutputName;
+    std::vector<Lighting::AdaLightOptions> ControllerOptions = { Lighting::AdaLightOptions{} };
+    Display::DisplayLightLayout LightLayout;
+  };
+
   struct Settings
   {
-    Lighting::AdaLightOptions ControllerOptions;
+    //A single controller, or several splitting the layout between them
+    std::vector<Lighting::AdaLightOptions> ControllerOptions = { Lighting::AdaLightOptions{} };
     Display::DisplayLightLayout LightLayout;
+
+    //Without outputs the default one is lit with the controller and layout above
+    std::vector<OutputSettings> Outputs;
+
+    Sampling::SamplingOptions SamplingOptions;
+    Capture::FrameSourceOptions FrameSourceOptions;
+    Colors::TemporalFilterOptions TemporalFilterOptions;
+    Infrastructure::TracingOptions TracingOptions;
   };
 
   class SettingsImporter
@@ -18,6 +39,8 @@ namespace AxoLight::Settings
   private:
     static void Parse(const winrt::Windows::Data::Json::JsonObject& json, Lighting::AdaLightOptions& options);
 
+    static void Parse(const winrt::Windows::Data::Json::IJsonValue& json, std::vector<Lighting::AdaLightOptions>& options);
+
     static void Parse(const winrt::Windows::Data::Json::JsonObject& json, Display::DisplaySize& displaySize);
 
     static void Parse(const winrt::Windows::Data::Json::JsonObject& json, Display::DisplayPosition& displayPosition);
@@ -25,5 +48,17 @@ namespace AxoLight::Settings
     static void Parse(const winrt::Windows::Data::Json::JsonObject& json, Display::DisplayLightStrip& displayLightStrip);
 
     static void Parse(const winrt::Windows::Data::Json::JsonObject& json, Display::DisplayLightLayout& displayLightLayout);
+
+    static void Parse(const winrt::Windows::Data::Json::JsonObject& json, OutputSettings& outputSettings);
+
+    static void Parse(const winrt::Windows::Data::Json::JsonObject& json, Sampling::EaseRange& easeRange);
+
+    static void Parse(const winrt::Windows::Data::Json::JsonObject& json, Sampling::SamplingOptions& samplingOptions);
+
+    static void Parse(const winrt::Windows::Data::Json::JsonObject& json, Capture::FrameSourceOptions& frameSourceOptions);
+
+    static void Parse(const winrt::Windows::Data::Json::JsonObject& json, Colors::TemporalFilterOptions& temporalFilterOptions);
+
+    static void Parse(const winrt::Windows::Data::Json::JsonObject& json, Infrastructure::TracingOptions& tracingOptions);
   };
 }
\ No newline at end of file
@@ -0,0 +1,50 @@
+#include "pch.h"
+#include "Simd.h"
+
+namespace AxoLight::Simd
+{
+  bool check_avx2()
+  {
+    std::array<int, 4> info;
+    __cpuid(info.data(), 0);
+    if (info[0] < 7) return false;
+
+    __cpuid(info.data(), 1);
+    auto hasOsxsave = (info[2] & (1 << 27)) != 0;
+    auto hasAvx = (info[2] & (1 << 28)) != 0;
+    auto hasFma = (info[2] & (1 << 12)) != 0;
+    if (!hasOsxsave || !hasAvx || !hasFma) return false;
+
+    if ((_xgetbv(0) & 0x6) != 0x6) return false;
+
+    __cpuidex(info.data(), 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+  }
+
+  bool has_avx2()
+  {
+    static const bool result = check_avx2();
+    return result;
+  }
+
+  bool check_avx512_vbmi()
+  {
+    if (!has_avx2()) return false;
+
+    //The OS must also preserve the opmask and upper ZMM registers
+    if ((_xgetbv(0) & 0xe6) != 0xe6) return false;
+
+    std::array<int, 4> info;
+    __cpuidex(info.data(), 7, 0);
+    auto hasAvx512F = (info[1] & (1 << 16)) != 0;
+    auto hasAvx512BW = (info[1] & (1 << 30)) != 0;
+    auto hasAvx512Vbmi = (info[2] & (1 << 1)) != 0;
+    return hasAvx512F && hasAvx512BW && hasAvx512Vbmi;
+  }
+
+  bool has_avx512_vbmi()
+  {
+    static const bool result = check_avx512_vbmi();
+    return result;
+  }
+}
@@ -0,0 +1,173 @@
+#pragma once
+#include "pch.h"
+
+namespace AxoLight::Simd
+{
+  bool has_avx2();
+
+  //VPERMB and the byte granular AVX-512 instructions it is used with
+  bool has_avx512_vbmi();
+
+  struct int_x4
+  {
+    static const size_t width = 4;
+    __m128i value;
+
+    int_x4() = default;
+    int_x4(__m128i value) : value(value) { }
+    int_x4(int32_t value) : value(_mm_set1_epi32(value)) { }
+
+    static int_x4 load(const int32_t* source) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(source)); }
+    void store(int32_t* target) const { _mm_storeu_si128(reinterpret_cast<__m128i*>(target), value); }
+
+    static int_x4 load_bytes(const uint8_t* source)
+    {
+      int32_t bytes;
+      memcpy(&bytes, source, sizeof(bytes));
+
+      auto zero = _mm_setzero_si128();
+      return _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(bytes), zero), zero);
+    }
+
+    //Stores the lanes saturated to 0..255
+    void store_bytes(uint8_t* target) const
+    {
+      auto words = _mm_packs_epi32(value, value);
+      auto bytes = _mm_cvtsi128_si32(_mm_packus_epi16(words, words));
+      memcpy(target, &bytes, sizeof(bytes));
+    }
+
+    static int_x4 gather(const uint32_t* source, const int32_t* indices)
+    {
+      return _mm_set_epi32(source[indices[3]], source[indices[2]], source[indices[1]], source[indices[0]]);
+    }
+
+    static int_x4 gather(const uint32_t* source, const int_x4& indices)
+    {
+      std::array<int32_t, width> lanes;
+      indices.store(lanes.data());
+      return gather(source, lanes.data());
+    }
+  };
+
+  inline int_x4 operator +(const int_x4& a, const int_x4& b) { return _mm_add_epi32(a.value, b.value); }
+  inline int_x4 operator -(const int_x4& a, const int_x4& b) { return _mm_sub_epi32(a.value, b.value); }
+  inline int_x4 operator &(const int_x4& a, const int_x4& b) { return _mm_and_si128(a.value, b.value); }
+  inline int_x4 operator >>(const int_x4& a, int count) { return _mm_srl_epi32(a.value, _mm_cvtsi32_si128(count)); }
+  inline int_x4 operator <<(const int_x4& a, int count) { return _mm_sll_epi32(a.value, _mm_cvtsi32_si128(count)); }
+
+  struct float_x4
+  {
+    static const size_t width = 4;
+    typedef int_x4 int_t;
+    __m128 value;
+
+    float_x4() = default;
+    float_x4(__m128 value) : value(value) { }
+    float_x4(float value) : value(_mm_set1_ps(value)) { }
+
+    static float_x4 load(const float* source) { return _mm_loadu_ps(source); }
+    void store(float* target) const { _mm_storeu_ps(target, value); }
+  };
+
+  inline float_x4 operator +(const float_x4& a, const float_x4& b) { return _mm_add_ps(a.value, b.value); }
+  inline float_x4 operator -(const float_x4& a, const float_x4& b) { return _mm_sub_ps(a.value, b.value); }
+  inline float_x4 operator *(const float_x4& a, const float_x4& b) { return _mm_mul_ps(a.value, b.value); }
+  inline float_x4 operator /(const float_x4& a, const float_x4& b) { return _mm_div_ps(a.value, b.value); }
+  inline float_x4 operator <(const float_x4& a, const float_x4& b) { return _mm_cmplt_ps(a.value, b.value); }
+  inline float_x4 operator <=(const float_x4& a, const float_x4& b) { return _mm_cmple_ps(a.value, b.value); }
+  inline float_x4 operator >(const float_x4& a, const float_x4& b) { return _mm_cmpgt_ps(a.value, b.value); }
+  inline float_x4 operator ==(const float_x4& a, const float_x4& b) { return _mm_cmpeq_ps(a.value, b.value); }
+  inline float_x4 min(const float_x4& a, const float_x4& b) { return _mm_min_ps(a.value, b.value); }
+  inline float_x4 max(const float_x4& a, const float_x4& b) { return _mm_max_ps(a.value, b.value); }
+  inline float_x4 abs(const float_x4& a) { return _mm_andnot_ps(_mm_set1_ps(-0.f), a.value); }
+  inline float_x4 select(const float_x4& mask, const float_x4& a, const float_x4& b) { return _mm_or_ps(_mm_and_ps(mask.value, a.value), _mm_andnot_ps(mask.value, b.value)); }
+  inline float_x4 to_float(const int_x4& a) { return _mm_cvtepi32_ps(a.value); }
+  inline int_x4 to_int(const float_x4& a) { return _mm_cvttps_epi32(a.value); }
+
+  struct int_x8
+  {
+    static const size_t width = 8;
+    __m256i value;
+
+    int_x8() = default;
+    int_x8(__m256i value) : value(value) { }
+    int_x8(int32_t value) : value(_mm256_set1_epi32(value)) { }
+
+    static int_x8 load(const int32_t* source) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source)); }
+    void store(int32_t* target) const { _mm256_storeu_si256(reinterpret_cast<__m256i*>(target), value); }
+
+    static int_x8 load_bytes(const uint8_t* source) { return _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(source))); }
+
+    //Stores the lanes saturated to 0..255
+    void store_bytes(uint8_t* target) const
+    {
+      auto words = _mm_packs_epi32(_mm256_castsi256_si128(value), _mm256_extracti128_si256(value, 1));
+      _mm_storel_epi64(reinterpret_cast<__m128i*>(target), _mm_packus_epi16(words, words));
+    }
+
+    static int_x8 gather(const uint32_t* source, const int32_t* indices)
+    {
+      return _mm256_i32gather_epi32(reinterpret_cast<const int*>(source), _mm256_loadu_si256(reinterpret_cast<const __m256i*>(indices)), 4);
+    }
+
+    static int_x8 gather(const uint32_t* source, const int_x8& indices)
+    {
+      return _mm256_i32gather_epi32(reinterpret_cast<const int*>(source), indices.value, 4);
+    }
+  };
+
+  inline int_x8 operator +(const int_x8& a, const int_x8& b) { return _mm256_add_epi32(a.value, b.value); }
+  inline int_x8 operator -(const int_x8& a, const int_x8& b) { return _mm256_sub_epi32(a.value, b.value); }
+  inline int_x8 operator &(const int_x8& a, const int_x8& b) { return _mm256_and_si256(a.value, b.value); }
+  inline int_x8 operator >>(const int_x8& a, int count) { return _mm256_srl_epi32(a.value, _mm_cvtsi32_si128(count)); }
+  inline int_x8 operator <<(const int_x8& a, int count) { return _mm256_sll_epi32(a.value, _mm_cvtsi32_si128(count)); }
+
+  struct float_x8
+  {
+    static const size_t width = 8;
+    typedef int_x8 int_t;
+    __m256 value;
+
+    float_x8() = default;
+    float_x8(__m256 value) : value(value) { }
+    float_x8(float value) : value(_mm256_set1_ps(value)) { }
+
+    static float_x8 load(const float* source) { return _mm256_loadu_ps(source); }
+    void store(float* target) const { _mm256_storeu_ps(target, value); }
+  };
+
+  inline float_x8 operator +(const float_x8& a, const float_x8& b) { return _mm256_add_ps(a.value, b.value); }
+  inline float_x8 operator -(const float_x8& a, const float_x8& b) { return _mm256_sub_ps(a.value, b.value); }
+  inline float_x8 operator *(const float_x8& a, const float_x8& b) { return _mm256_mul_ps(a.value, b.value); }
+  inline float_x8 operator /(const float_x8& a, const float_x8& b) { return _mm256_div_ps(a.value, b.value); }
+  inline float_x8 operator <(const float_x8& a, const float_x8& b) { return _mm256_cmp_ps(a.value, b.value, _CMP_LT_OQ); }
+  inline float_x8 operator <=(const float_x8& a, const float_x8& b) { return _mm256_cmp_ps(a.value, b.value, _CMP_LE_OQ); }
+  inline float_x8 operator >(const float_x8& a, const float_x8& b) { return _mm256_cmp_ps(a.value, b.value, _CMP_GT_OQ); }
+  inline float_x8 operator ==(const float_x8& a, const float_x8& b) { return _mm256_cmp_ps(a.value, b.value, _CMP_EQ_OQ); }
+  inline float_x8 min(const float_x8& a, const float_x8& b) { return _mm256_min_ps(a.value, b.value); }
+  inline float_x8 max(const float_x8& a, const float_x8& b) { return _mm256_max_ps(a.value, b.value); }
+  inline float_x8 abs(const float_x8& a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.f), a.value); }
+  inline float_x8 select(const float_x8& mask, const float_x8& a, const float_x8& b) { return _mm256_blendv_ps(b.value, a.value, mask.value); }
+  inline float_x8 to_float(const int_x8& a) { return _mm256_cvtepi32_ps(a.value); }
+  inline int_x8 to_int(const float_x8& a) { return _mm256_cvttps_epi32(a.value); }
+
+  template<typename TInt>
+  int32_t horizontal_sum(const TInt& value)
+  {
+    std::array<int32_t, TInt::width> lanes;
+    value.store(lanes.data());
+
+    int32_t result = 0;
+    for (auto lane : lanes) result += lane;
+    return result;
+  }
+
+  //Odd polynomial approximation of sin, accurate to ~1e-7 for |x| <= pi / 4
+  template<typename TFloat>
+  TFloat sin_approx(const TFloat& x)
+  {
+    auto x2 = x * x;
+    return x * (TFloat(1.f) + x2 * (TFloat(-1.f / 6.f) + x2 * (TFloat(1.f / 120.f) + x2 * (TFloat(-1.f / 5040.f) + x2 * TFloat(1.f / 362880.f)))));
+  }
+}
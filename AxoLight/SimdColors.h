@@ -0,0 +1,51 @@
+#pragma once
+#include "pch.h"
+#include "Simd.h"
+
+namespace AxoLight::Colors
+{
+  //Branchless counterparts of rgb_to_hsl and hsl_to_rgb, one color per lane with the rgb channels normalized to 0..1
+  template<typename TFloat>
+  void rgb_to_hsl(const TFloat& r, const TFloat& g, const TFloat& b, TFloat& h, TFloat& s, TFloat& l)
+  {
+    auto maximum = max(max(r, g), b);
+    auto minimum = min(min(r, g), b);
+    auto diff = maximum - minimum;
+    auto sum = maximum + minimum;
+    l = sum * TFloat(0.5f);
+    s = diff / select(l <= TFloat(0.5f), sum, TFloat(2.f) - sum);
+
+    auto distR = (maximum - r) / diff;
+    auto distG = (maximum - g) / diff;
+    auto distB = (maximum - b) / diff;
+    h = select(r == maximum, distB - distG,
+      select(g == maximum, TFloat(2.f) + distR - distB, TFloat(4.f) + distG - distR)) * TFloat(60.f);
+    h = select(h < TFloat(0.f), h + TFloat(360.f), h);
+
+    auto isGray = abs(diff) < TFloat(0.00001f);
+    s = select(isGray, TFloat(0.f), s);
+    h = select(isGray, TFloat(0.f), h);
+  }
+
+  template<typename TFloat>
+  TFloat qqh_to_rgb(const TFloat& q1, const TFloat& q2, TFloat hue)
+  {
+    hue = select(hue > TFloat(360.f), hue - TFloat(360.f), select(hue < TFloat(0.f), hue + TFloat(360.f), hue));
+
+    auto slope = (q2 - q1) * TFloat(1.f / 60.f);
+    return select(hue < TFloat(60.f), q1 + slope * hue,
+      select(hue < TFloat(180.f), q2,
+        select(hue < TFloat(240.f), q1 + slope * (TFloat(240.f) - hue), q1)));
+  }
+
+  template<typename TFloat>
+  void hsl_to_rgb(const TFloat& h, const TFloat& s, const TFloat& l, TFloat& r, TFloat& g, TFloat& b)
+  {
+    auto p2 = select(l <= TFloat(0.5f), l * (TFloat(1.f) + s), l + s - l * s);
+    auto p1 = TFloat(2.f) * l - p2;
+    auto isFlat = s == TFloat(0.f);
+    r = select(isFlat, l, qqh_to_rgb(p1, p2, h + TFloat(120.f)));
+    g = select(isFlat, l, qqh_to_rgb(p1, p2, h));
+    b = select(isFlat, l, qqh_to_rgb(p1, p2, h - TFloat(120.f)));
+  }
+}
\ No newline at end of file
@@ -0,0 +1,67 @@
+#include "pch.h"
+#include "SummedAreaTable.h"
+
+using namespace std;
+
+namespace AxoLight::Sampling
+{
+  summed_area_table::summed_area_table()
+  {
+    for (auto i = 0u; i < _lattice.size(); i++)
+    {
+      _lattice[i] = uint8_t((i + transfer_lut::step / 2) / transfer_lut::step);
+    }
+  }
+
+  void summed_area_table::update(const frame_view& frame, const transfer_lut& transferLut, const RECT& region)
+  {
+    //The first row and column stay zero, so every box is four lookups without edge cases
+    auto width = uint32_t(region.right - region.left);
+    auto height = uint32_t(region.bottom - region.top);
+    auto stride = size_t(width) + 1;
+    if (width != _width || height != _height)
+    {
+      _width = width;
+      _height = height;
+      _sums.assign(stride * (size_t(_height) + 1), {});
+    }
+    _region = region;
+
+    auto entries = transferLut.entries.data();
+    auto zero = _mm_setzero_si128();
+    for (auto y = 0u; y < _height; y++)
+    {
+      auto pixels = frame.row(y + uint32_t(region.top)) + region.left;
+      auto above = reinterpret_cast<const __m128i*>(_sums.data() + y * stride + 1);
+      auto target = reinterpret_cast<__m128i*>(_sums.data() + (y + 1) * stride + 1);
+
+      //The channels of a pixel fill the lanes, red and green in the first register and blue and weight in the second, so the running row sum is two additions per pixel
+      auto rowSumRG = zero, rowSumBW = zero;
+      for (auto x = 0u; x < _width; x++)
+      {
+        auto pixel = pixels[x];
+        auto& entry = entries[transfer_lut::index(_lattice[(pixel >> 16) & 0xff], _lattice[(pixel >> 8) & 0xff], _lattice[pixel & 0xff])];
+
+        auto value = _mm_unpacklo_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(entry.data())), zero);
+        rowSumRG = _mm_add_epi64(rowSumRG, _mm_unpacklo_epi32(value, zero));
+        rowSumBW = _mm_add_epi64(rowSumBW, _mm_unpackhi_epi32(value, zero));
+        _mm_storeu_si128(target + 2 * x, _mm_add_epi64(rowSumRG, _mm_loadu_si128(above + 2 * x)));
+        _mm_storeu_si128(target + 2 * x + 1, _mm_add_epi64(rowSumBW, _mm_loadu_si128(above + 2 * x + 1)));
+      }
+    }
+  }
+
+  std::array<uint64_t, 4> summed_area_table::sum(const RECT& box) const
+  {
+    auto stride = size_t(_width) + 1;
+    auto at = [&](LONG x, LONG y, size_t half) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(_sums.data() + size_t(y - _region.top) * stride + (x - _region.left)) + half); };
+
+    array<uint64_t, 4> sums;
+    for (size_t half = 0u; half < 2u; half++)
+    {
+      auto result = _mm_add_epi64(_mm_sub_epi64(at(box.right, box.bottom, half), at(box.right, box.top, half)), _mm_sub_epi64(at(box.left, box.top, half), at(box.left, box.bottom, half)));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(sums.data()) + half, result);
+    }
+    return sums;
+  }
+}
\ No newline at end of file
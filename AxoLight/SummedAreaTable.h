@@ -0,0 +1,27 @@
+#pragma once
+#include "pch.h"
+#include "Sampling.h"
+#include "TransferLut.h"
+
+namespace AxoLight::Sampling
+{
+  //Integral image of the transferred pixels of a region, each entry holds the weighted rgb and weight sums of every pixel above and left of it.
+  //A pixel adds up to 255 * 255 to each color sum, so the sums are 64 bits wide, 32 bits would wrap for boxes of more than 66051 pixels.
+  struct summed_area_table
+  {
+  private:
+    RECT _region{};
+    uint32_t _width = 0u, _height = 0u;
+    std::vector<std::array<uint64_t, 4>> _sums;
+    std::array<uint8_t, 256> _lattice;
+
+  public:
+    summed_area_table();
+
+    //Rebuilds the table from the pixels of the region, looking up the nearest transfer table point of every pixel
+    void update(const frame_view& frame, const transfer_lut& transferLut, const RECT& region);
+
+    //Sums of the pixels in [left, right) x [top, bottom), in frame coordinates inside the region
+    std::array<uint64_t, 4> sum(const RECT& box) const;
+  };
+}
\ No newline at end of file
@@ -0,0 +1,242 @@
+#include "pch.h"
+#include "TemporalFilter.h"
+#include "Simd.h"
+
+using namespace std;
+using namespace std::chrono;
+
+namespace AxoLight::Colors
+{
+  static_assert(sizeof(rgb) == 3, "The filter treats colors as a flat channel array.");
+
+  const int16_t max_value = 255 << 7;
+  const size_t lane_count = 16u;
+
+  int16_t to_q15(float value)
+  {
+    return int16_t(clamp(lroundf(value * 32768.f), -32768l, 32767l));
+  }
+
+  int16_t mulhrs(int16_t a, int16_t b)
+  {
+    return int16_t((int32_t(a) * b + 0x4000) >> 15);
+  }
+
+  int16_t adds(int32_t a, int32_t b)
+  {
+    return int16_t(clamp(a + b, -32768, 32767));
+  }
+
+  int16_t step_sign(int32_t value)
+  {
+    return int16_t((value > 0) - (value < 0));
+  }
+
+  //Moves the error towards zero by at least one step, so rounding can never stop the value short of its target
+  int16_t ensure_progress(int16_t error, int16_t newError)
+  {
+    return newError == error ? int16_t(newError - step_sign(error)) : newError;
+  }
+
+  void update_linear(const temporal_filter::coefficients& k, const int16_t* targets, int16_t* values, int16_t* velocities, size_t count)
+  {
+    for (size_t i = 0u; i < count; i++)
+    {
+      auto error = int16_t(values[i] - targets[i]);
+      auto velocity = velocities[i];
+
+      auto newError = adds(mulhrs(error, k.value_from_error), mulhrs(velocity, k.value_from_velocity));
+      velocities[i] = adds(mulhrs(error, k.velocity_from_error), mulhrs(velocity, k.velocity_from_velocity));
+
+      newError = ensure_progress(error, newError);
+      values[i] = clamp(adds(targets[i], newError), int16_t(0), max_value);
+    }
+  }
+
+  void update_linear_avx2(const temporal_filter::coefficients& k, const int16_t* targets, int16_t* values, int16_t* velocities, size_t count)
+  {
+    auto valueFromError = _mm256_set1_epi16(k.value_from_error);
+    auto valueFromVelocity = _mm256_set1_epi16(k.value_from_velocity);
+    auto velocityFromError = _mm256_set1_epi16(k.velocity_from_error);
+    auto velocityFromVelocity = _mm256_set1_epi16(k.velocity_from_velocity);
+    auto one = _mm256_set1_epi16(1);
+    auto zero = _mm256_setzero_si256();
+    auto maxValue = _mm256_set1_epi16(max_value);
+
+    for (size_t i = 0u; i < count; i += lane_count)
+    {
+      auto target = _mm256_loadu_si256((const __m256i*)(targets + i));
+      auto value = _mm256_loadu_si256((const __m256i*)(values + i));
+      auto velocity = _mm256_loadu_si256((const __m256i*)(velocities + i));
+
+      auto error = _mm256_sub_epi16(value, target);
+      auto newError = _mm256_adds_epi16(_mm256_mulhrs_epi16(error, valueFromError), _mm256_mulhrs_epi16(velocity, valueFromVelocity));
+      velocity = _mm256_adds_epi16(_mm256_mulhrs_epi16(error, velocityFromError), _mm256_mulhrs_epi16(velocity, velocityFromVelocity));
+
+      auto isStuck = _mm256_cmpeq_epi16(newError, error);
+      newError = _mm256_sub_epi16(newError, _mm256_and_si256(isStuck, _mm256_sign_epi16(one, error)));
+      value = _mm256_min_epi16(_mm256_max_epi16(_mm256_adds_epi16(target, newError), zero), maxValue);
+
+      _mm256_storeu_si256((__m256i*)(values + i), value);
+      _mm256_storeu_si256((__m256i*)(velocities + i), velocity);
+    }
+  }
+
+  void update_one_euro(const temporal_filter::coefficients& k, const int16_t* targets, int16_t* values, int16_t* derivatives, size_t count)
+  {
+    for (size_t i = 0u; i < count; i++)
+    {
+      auto target = float(targets[i]);
+      auto value = float(values[i]);
+      auto derivative = float(derivatives[i]);
+
+      derivative = derivative + k.derivative_alpha * ((target - value) * k.derivative_scale - derivative);
+
+      auto cutoff = k.min_cutoff + k.beta * fabsf(derivative);
+      auto ratio = k.cutoff_scale * cutoff;
+      auto alpha = ratio / (ratio + 1.f);
+
+      auto newValue = int32_t(nearbyintf(value + alpha * (target - value)));
+      if (newValue == values[i] && targets[i] != values[i]) newValue += step_sign(targets[i] - values[i]);
+
+      values[i] = int16_t(clamp(newValue, 0, int32_t(max_value)));
+      derivatives[i] = int16_t(nearbyintf(clamp(derivative, -32767.f, 32767.f)));
+    }
+  }
+
+  void update_one_euro_avx2(const temporal_filter::coefficients& k, const int16_t* targets, int16_t* values, int16_t* derivatives, size_t count)
+  {
+    auto derivativeScale = _mm256_set1_ps(k.derivative_scale);
+    auto derivativeAlpha = _mm256_set1_ps(k.derivative_alpha);
+    auto minCutoff = _mm256_set1_ps(k.min_cutoff);
+    auto beta = _mm256_set1_ps(k.beta);
+    auto cutoffScale = _mm256_set1_ps(k.cutoff_scale);
+    auto absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+    auto oneFloat = _mm256_set1_ps(1.f);
+    auto maxDerivative = _mm256_set1_ps(32767.f);
+    auto minDerivative = _mm256_set1_ps(-32767.f);
+    auto one = _mm256_set1_epi32(1);
+    auto zero = _mm256_setzero_si256();
+    auto maxValue = _mm256_set1_epi32(max_value);
+
+    auto load = [](const int16_t* source) { return _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i*)source)); };
+    auto store = [](int16_t* target, __m256i value) { _mm_storeu_si128((__m128i*)target, _mm_packs_epi32(_mm256_castsi256_si128(value), _mm256_extracti128_si256(value, 1))); };
+
+    for (size_t i = 0u; i < count; i += 8u)
+    {
+      auto targetInt = load(targets + i);
+      auto valueInt = load(values + i);
+      auto target = _mm256_cvtepi32_ps(targetInt);
+      auto value = _mm256_cvtepi32_ps(valueInt);
+      auto derivative = _mm256_cvtepi32_ps(load(derivatives + i));
+
+      auto difference = _mm256_sub_ps(target, value);
+      derivative = _mm256_add_ps(derivative, _mm256_mul_ps(derivativeAlpha, _mm256_sub_ps(_mm256_mul_ps(difference, derivativeScale), derivative)));
+
+      auto cutoff = _mm256_add_ps(minCutoff, _mm256_mul_ps(beta, _mm256_and_ps(derivative, absMask)));
+      auto ratio = _mm256_mul_ps(cutoffScale, cutoff);
+      auto alpha = _mm256_div_ps(ratio, _mm256_add_ps(ratio, oneFloat));
+
+      auto newValue = _mm256_cvtps_epi32(_mm256_add_ps(value, _mm256_mul_ps(alpha, difference)));
+      auto isStuck = _mm256_andnot_si256(_mm256_cmpeq_epi32(targetInt, valueInt), _mm256_cmpeq_epi32(newValue, valueInt));
+      newValue = _mm256_add_epi32(newValue, _mm256_and_si256(isStuck, _mm256_sign_epi32(one, _mm256_sub_epi32(targetInt, valueInt))));
+      newValue = _mm256_min_epi32(_mm256_max_epi32(newValue, zero), maxValue);
+
+      derivative = _mm256_min_ps(_mm256_max_ps(derivative, minDerivative), maxDerivative);
+
+      store(values + i, newValue);
+      store(derivatives + i, _mm256_cvtps_epi32(derivative));
+    }
+  }
+
+  temporal_filter::temporal_filter(const TemporalFilterOptions& options, size_t lightCount) :
+    _options(options),
+    _useAvx2(Simd::has_avx2()),
+    _channelCount(lightCount * 3)
+  {
+    auto paddedCount = (_channelCount + lane_count - 1) / lane_count * lane_count;
+    _targets.resize(paddedCount);
+    _values.resize(paddedCount);
+    _velocities.resize(paddedCount);
+  }
+
+  temporal_filter::coefficients temporal_filter::make_coefficients(std::chrono::steady_clock::duration elapsed) const
+  {
+    coefficients result{};
+
+    auto timeStep = duration<float>(elapsed).count();
+    auto timeConstant = max(duration<float>(_options.TimeConstant).count(), 1e-6f);
+    auto step = min(timeStep / timeConstant, 50.f);
+    auto decay = expf(-step);
+
+    switch (_options.Type)
+    {
+    case TemporalFilterType::Exponential:
+      result.value_from_error = to_q15(decay);
+      break;
+    case TemporalFilterType::CriticallyDamped:
+      //Exact solution of a critically damped spring over the time step, with the velocity scaled by the time constant
+      result.value_from_error = to_q15(decay * (1.f + step));
+      result.value_from_velocity = to_q15(decay * step);
+      result.velocity_from_error = to_q15(-decay * step);
+      result.velocity_from_velocity = to_q15(decay * (1.f - step));
+      break;
+    case TemporalFilterType::OneEuro:
+    {
+      auto cutoffScale = 2.f * float(M_PI) * timeStep;
+      auto derivativeRatio = cutoffScale * _options.DerivativeCutoff;
+
+      //Derivatives are kept in color levels per second
+      result.derivative_scale = 1.f / (128.f * timeStep);
+      result.derivative_alpha = derivativeRatio / (derivativeRatio + 1.f);
+      result.min_cutoff = _options.MinCutoff;
+      result.beta = _options.Beta;
+      result.cutoff_scale = cutoffScale;
+      break;
+    }
+    }
+
+    return result;
+  }
+
+  void temporal_filter::update(const std::vector<rgb>& targets, std::vector<rgb>& colors)
+  {
+    auto now = steady_clock::now();
+    auto elapsed = _lastUpdate == steady_clock::time_point() ? steady_clock::duration::zero() : now - _lastUpdate;
+    _lastUpdate = now;
+
+    update(targets, elapsed, colors);
+  }
+
+  void temporal_filter::update(const std::vector<rgb>& targets, std::chrono::steady_clock::duration elapsed, std::vector<rgb>& colors)
+  {
+    if (targets.size() * 3 != _channelCount) throw winrt::hresult_invalid_argument(L"The target count does not match the light count of the filter.");
+
+    auto targetChannels = (const uint8_t*)targets.data();
+    for (size_t i = 0u; i < _channelCount; i++)
+    {
+      _targets[i] = int16_t(targetChannels[i] << 7);
+    }
+
+    if (elapsed > steady_clock::duration::zero())
+    {
+      auto k = make_coefficients(elapsed);
+      auto count = _values.size();
+      if (_options.Type == TemporalFilterType::OneEuro)
+      {
+        (_useAvx2 ? update_one_euro_avx2 : update_one_euro)(k, _targets.data(), _values.data(), _velocities.data(), count);
+      }
+      else
+      {
+        (_useAvx2 ? update_linear_avx2 : update_linear)(k, _targets.data(), _values.data(), _velocities.data(), count);
+      }
+    }
+
+    colors.resize(targets.size());
+    auto colorChannels = (uint8_t*)colors.data();
+    for (size_t i = 0u; i < _channelCount; i++)
+    {
+      colorChannels[i] = uint8_t((_values[i] + 64) >> 7);
+    }
+  }
+}
\ No newline at end of file
@@ -0,0 +1,63 @@
+#pragma once
+#include "pch.h"
+#include "Colors.h"
+
+namespace AxoLight::Colors
+{
+  enum class TemporalFilterType
+  {
+    Exponential,
+    CriticallyDamped,
+    OneEuro
+  };
+
+  struct TemporalFilterOptions
+  {
+    TemporalFilterType Type = TemporalFilterType::Exponential;
+
+    //Exponential and critically damped
+    std::chrono::microseconds TimeConstant = std::chrono::microseconds(75000);
+
+    //One euro, cutoffs in Hz and beta in Hz per color level per second
+    float MinCutoff = 2.f;
+    float Beta = 0.01f;
+    float DerivativeCutoff = 1.f;
+  };
+
+  //Smooths light colors over real time, the state is kept per channel in 8.7 fixed point so colors converge exactly
+  struct temporal_filter
+  {
+  public:
+    struct coefficients
+    {
+      //Exponential and critically damped, Q15 factors applied to the error and velocity
+      int16_t value_from_error, value_from_velocity;
+      int16_t velocity_from_error, velocity_from_velocity;
+
+      //One euro
+      float derivative_scale, derivative_alpha;
+      float min_cutoff, beta, cutoff_scale;
+    };
+
+  private:
+    TemporalFilterOptions _options;
+    bool _useAvx2;
+    size_t _channelCount;
+
+    std::vector<int16_t> _targets;
+    std::vector<int16_t> _values;
+    std::vector<int16_t> _velocities;
+
+    std::chrono::steady_clock::time_point _lastUpdate;
+
+    coefficients make_coefficients(std::chrono::steady_clock::duration elapsed) const;
+
+  public:
+    temporal_filter(const TemporalFilterOptions& options, size_t lightCount);
+
+    //Advances the filter by the time passed since the previous update
+    void update(const std::vector<rgb>& targets, std::vector<rgb>& colors);
+
+    void update(const std::vector<rgb>& targets, std::chrono::steady_clock::duration elapsed, std::vector<rgb>& colors);
+  };
+}
\ No newline at end of file
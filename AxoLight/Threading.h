@@ -0,0 +1,75 @@
+#pragma once
+#include "pch.h"
+
+namespace AxoLight::Infrastructure
+{
+  //Lock-free single producer / single consumer handoff, the consumer always receives the newest published value
+  template<typename T>
+  struct triple_buffer
+  {
+  private:
+    static const uint8_t _freshBit = 0x4;
+
+    std::array<T, 3> _buffers;
+    std::atomic<uint8_t> _middle = 1u;
+    uint8_t _back = 0u;
+    uint8_t _front = 2u;
+    winrt::handle _publishedEvent;
+
+  public:
+    triple_buffer(const T& value = {}) :
+      _buffers{ value, value, value },
+      _publishedEvent(CreateEvent(nullptr, false, false, nullptr))
+    { }
+
+    triple_buffer(const triple_buffer&) = delete;
+    triple_buffer& operator=(const triple_buffer&) = delete;
+
+    //Producer side: the buffer to fill before calling publish
+    T& back()
+    {
+      return _buffers[_back];
+    }
+
+    //Producer side: makes the back buffer visible to the consumer, returns false if the previously published value was never consumed
+    bool publish()
+    {
+      auto previous = _middle.exchange(uint8_t(_back | _freshBit), std::memory_order_acq_rel);
+      _back = previous & ~_freshBit;
+
+      SetEvent(_publishedEvent.get());
+      return !(previous & _freshBit);
+    }
+
+    //Consumer side: switches the front buffer to the newest published value, returns false if nothing was published since the last call
+    bool update()
+    {
+      if (!(_middle.load(std::memory_order_relaxed) & _freshBit)) return false;
+
+      auto previous = _middle.exchange(_front, std::memory_order_acq_rel);
+      _front = previous & ~_freshBit;
+      return true;
+    }
+
+    //Consumer side: like update, but waits up to timeout milliseconds for a new value
+    bool wait_update(uint32_t timeout = INFINITE)
+    {
+      if (update()) return true;
+
+      WaitForSingleObject(_publishedEvent.get(), timeout);
+      return update();
+    }
+
+    //Wakes a consumer waiting in wait_update without publishing anything, so it can check whether it should stop
+    void interrupt()
+    {
+      SetEvent(_publishedEvent.get());
+    }
+
+    //Consumer side: the newest value received by update
+    T& front()
+    {
+      return _buffers[_front];
+    }
+  };
+}
\ No newline at end of file
@@ -0,0 +1,113 @@
+#include "pch.h"
+#include "Tracing.h"
+
+using namespace std;
+using namespace std::chrono;
+
+using namespace winrt;
+
+namespace AxoLight::Infrastructure
+{
+  struct trace_event
+  {
+    //0 while being written, otherwise the index of the event plus one
+    atomic<uint64_t> sequence = 0u;
+    atomic<const char*> name = nullptr;
+    atomic<uint32_t> thread = 0u;
+    atomic<int64_t> start = 0;
+    atomic<int64_t> duration = 0;
+    atomic<uint64_t> frame = 0u;
+  };
+
+  atomic<bool> _isTracing = false;
+  unique_ptr<trace_event[]> _traceEvents;
+  uint64_t _traceCapacity = 0u;
+  atomic<uint64_t> _nextTraceEvent = 0u;
+  steady_clock::time_point _traceStart;
+
+  mutex _threadNameMutex;
+  vector<pair<uint32_t, string>> _threadNames;
+
+  void trace_buffer::start(uint32_t capacity)
+  {
+    if (_isTracing) throw hresult_illegal_method_call(L"Tracing is already started.");
+
+    _traceCapacity = max(capacity, 1u);
+    _traceEvents = make_unique<trace_event[]>(_traceCapacity);
+    _traceStart = steady_clock::now();
+    _isTracing = true;
+  }
+
+  bool trace_buffer::is_enabled()
+  {
+    return _isTracing.load(memory_order_relaxed);
+  }
+
+  void trace_buffer::name_thread(const char* name)
+  {
+    lock_guard<mutex> lock(_threadNameMutex);
+    _threadNames.emplace_back(GetCurrentThreadId(), name);
+  }
+
+  void trace_buffer::record(const char* name, std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end, uint64_t frame)
+  {
+    if (!is_enabled()) return;
+
+    auto index = _nextTraceEvent.fetch_add(1u, memory_order_relaxed);
+    auto& event = _traceEvents[index % _traceCapacity];
+
+    event.sequence.store(0u, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    event.name.store(name, memory_order_relaxed);
+    event.thread.store(GetCurrentThreadId(), memory_order_relaxed);
+    event.start.store(duration_cast<microseconds>(start - _traceStart).count(), memory_order_relaxed);
+    event.duration.store(duration_cast<microseconds>(end - start).count(), memory_order_relaxed);
+    event.frame.store(frame, memory_order_relaxed);
+
+    event.sequence.store(index + 1u, memory_order_release);
+  }
+
+  void trace_buffer::save(const std::filesystem::path& path)
+  {
+    if (!is_enabled()) return;
+
+    FILE* file = nullptr;
+    _wfopen_s(&file, path.c_str(), L"wb");
+    if (!file) throw hresult_invalid_argument(L"Cannot open trace file for writing.");
+
+    fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    fprintf(file, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"AxoLight\"}}");
+
+    {
+      lock_guard<mutex> lock(_threadNameMutex);
+      for (auto& [thread, name] : _threadNames)
+      {
+        fprintf(file, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}}", thread, name.c_str());
+      }
+    }
+
+    //Slots being rewritten while saving are skipped
+    for (uint64_t i = 0u; i < _traceCapacity; i++)
+    {
+      auto& event = _traceEvents[i];
+      auto sequence = event.sequence.load(memory_order_acquire);
+      if (sequence == 0u) continue;
+
+      auto name = event.name.load(memory_order_relaxed);
+      auto thread = event.thread.load(memory_order_relaxed);
+      auto start = event.start.load(memory_order_relaxed);
+      auto duration = event.duration.load(memory_order_relaxed);
+      auto frame = event.frame.load(memory_order_relaxed);
+
+      atomic_thread_fence(memory_order_acquire);
+      if (event.sequence.load(memory_order_relaxed) != sequence) continue;
+
+      fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%lld,\"dur\":%lld,\"args\":{\"frame\":%llu}}",
+        name, thread, start, duration, frame);
+    }
+
+    fprintf(file, "\n]}\n");
+    fclose(file);
+  }
+}
\ No newline at end of file
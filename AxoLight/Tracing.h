@@ -0,0 +1,30 @@
+#pragma once
+#include "pch.h"
+
+namespace AxoLight::Infrastructure
+{
+  struct TracingOptions
+  {
+    bool IsEnabled = false;
+    uint32_t Capacity = 65536;
+    std::filesystem::path Path = L"trace.json";
+  };
+
+  //Process wide ring buffer of timed spans, once full the oldest spans are overwritten.
+  //Recording is lock-free, each slot is guarded by a sequence number so saving never blocks the recording threads.
+  struct trace_buffer
+  {
+    static void start(uint32_t capacity);
+
+    static bool is_enabled();
+
+    //Names the current thread in the saved traces
+    static void name_thread(const char* name);
+
+    //The name must be a string literal or otherwise outlive the buffer
+    static void record(const char* name, std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end, uint64_t frame = 0u);
+
+    //Writes the spans recorded so far in the Chrome trace event format, which Perfetto and chrome://tracing both open
+    static void save(const std::filesystem::path& path);
+  };
+}
\ No newline at end of file
@@ -0,0 +1,56 @@
+#include "pch.h"
+#include "TransferLut.h"
+
+using namespace AxoLight::Colors;
+
+using namespace std;
+
+namespace AxoLight::Sampling
+{
+  float ease(float t, const EaseRange& range)
+  {
+    if (t < range.Start) return 0;
+    if (t > range.End) return 1;
+
+    float x = 2 * ((t - range.Start) / (range.End - range.Start) - 0.5f);
+    return 0.5f * (sinf(x * 2 / float(M_PI)) + 1);
+  }
+
+  transfer_lut::transfer_lut(const SamplingOptions& options)
+  {
+    entries.resize(size * size * size);
+    for (auto r = 0u; r < size; r++)
+    {
+      for (auto g = 0u; g < size; g++)
+      {
+        for (auto b = 0u; b < size; b++)
+        {
+          entries[index(r, g, b)] = transform({ uint8_t(r * step), uint8_t(g * step), uint8_t(b * step) }, options);
+        }
+      }
+    }
+  }
+
+  const std::array<uint16_t, 4>& transfer_lut::at(const Colors::rgb& color) const
+  {
+    auto lattice = [](uint8_t value) { return (value + step / 2) / step; };
+    return entries[index(lattice(color.r), lattice(color.g), lattice(color.b))];
+  }
+
+  std::array<uint16_t, 4> transfer_lut::transform(const Colors::rgb& color, const SamplingOptions& options)
+  {
+    auto hsl = rgb_to_hsl(color);
+
+    auto factor = 255.f * ease(hsl.l, options.WeightRange);
+    hsl.l = ease(hsl.l, options.LightnessRange);
+    hsl.s = ease(hsl.s, options.SaturationRange);
+
+    auto result = hsl_to_rgb(hsl);
+    return {
+      uint16_t(result.r * factor),
+      uint16_t(result.g * factor),
+      uint16_t(result.b * factor),
+      uint16_t(factor)
+    };
+  }
+}
\ No newline at end of file
@@ -0,0 +1,26 @@
+#pragma once
+#include "pch.h"
+#include "Sampling.h"
+
+namespace AxoLight::Sampling
+{
+  //The sampler transform of a pixel baked on a lattice with a point every 5 color levels, each entry is the weighted rgb followed by the weight
+  struct transfer_lut
+  {
+  public:
+    static const uint32_t size = 52u;
+    static const uint32_t step = 255u / (size - 1u);
+
+    std::vector<std::array<uint16_t, 4>> entries;
+
+    transfer_lut(const SamplingOptions& options);
+
+    //Blue is the fastest changing axis, so the table is a 3D texture sampled at bgr
+    static uint32_t index(uint32_t r, uint32_t g, uint32_t b) { return (r * size + g) * size + b; }
+
+    //Nearest lattice point of a color
+    const std::array<uint16_t, 4>& at(const Colors::rgb& color) const;
+
+    static std::array<uint16_t, 4> transform(const Colors::rgb& color, const SamplingOptions& options);
+  };
+}
\ No newline at end of file
@@ -4,12 +4,22 @@
 #include "Infrastructure.h"
 #include "SettingsImporter.h"
 #include "Colors.h"
-
+#include "Sampling.h"
+#include "CpuSampler.h"
+#include "TransferLut.h"
+#include "FrameSources.h"
+#include "Metrics.h"
+#include "TemporalFilter.h"
+#include "Threading.h"
+#include "Tracing.h"
+
+using namespace AxoLight::Capture;
 using namespace AxoLight::Display;
 using namespace AxoLight::Colors;
 using namespace AxoLight::Graphics;
 using namespace AxoLight::Infrastructure;
 using namespace AxoLight::Lighting;
+using namespace AxoLight::Sampling;
 using namespace AxoLight::Settings;
 
 using namespace std;
@@ -26,127 +36,377 @@ struct constants_t
   float2 SampleStep;
 };
 
-union rect
+struct sampled_frame
 {
-  struct {
-    float left, top, right, bottom;
-  };
-  struct {
-    float2 top_left, bottom_right;
-  };
+  uint64_t index = 0u;
+  std::chrono::steady_clock::time_point capture_time;
+  std::vector<std::array<uint32_t, 4>> sums;
+  std::vector<uint32_t> changed_rects;
+};
 
-  rect(float top, float left, float bottom, float right) :
-    left(left),
-    top(top),
-    right(right),
-    bottom(bottom)
-  { }
+struct light_frame
+{
+  uint64_t index = 0u;
+  std::chrono::steady_clock::time_point capture_time;
+  std::vector<AxoLight::Colors::rgb> colors;
+};
 
-  rect(float2 topLeft, float2 bottomRight) :
-    left(topLeft.x),
-    top(topLeft.y),
-    right(bottomRight.x),
-    bottom(bottomRight.y)
-  { }
+struct pipeline_latencies
+{
+  latency_histogram capture_wait;
+  latency_histogram sampling;
+  latency_histogram readback;
+  latency_histogram mixing;
+  latency_histogram filtering;
+  latency_histogram encoding;
+};
 
-  bool intersects(const rect& other) const
+void PrintLatencies(const pipeline_latencies& latencies, const AdaLightControllerGroup& controllers)
+{
+  printf("Latencies\n");
+  print_latency("capture wait", latencies.capture_wait.snapshot());
+  print_latency("sampling", latencies.sampling.snapshot());
+  print_latency("readback", latencies.readback.snapshot());
+  print_latency("mixing", latencies.mixing.snapshot());
+  print_latency("filtering", latencies.filtering.snapshot());
+  print_latency("encoding", latencies.encoding.snapshot());
+
+  auto controllerCount = controllers.GetControllerCount();
+  for (size_t i = 0u; i < controllerCount; i++)
   {
-    return (left < other.right && right > other.left && top > other.bottom && bottom < other.top);
+    auto controllerLatencies = controllers.GetController(i).GetLatencies();
+    if (controllerCount > 1) printf("Controller %zu\n", i);
+    print_latency("serial write", controllerLatencies.Write);
+    print_latency("capture to wire", controllerLatencies.CaptureToWire);
+    if (controllerCount > 1) print_latency("latch skew", controllerLatencies.LatchSkew);
+  }
+}
+
+void MixColors(const SamplingDescription& samplingDescription, const std::vector<std::array<uint32_t, 4>>& data, const std::vector<uint32_t>& changedRects, std::vector<bool>& isLightChanged, std::vector<uint32_t>& changedLights, std::vector<AxoLight::Colors::rgb>& targetColors)
+{
+  auto& rectLights = samplingDescription.RectLights;
+
+  isLightChanged.assign(targetColors.size(), false);
+  changedLights.clear();
+  for (auto changedRect : changedRects)
+  {
+    for (auto i = rectLights.offsets[changedRect]; i < rectLights.offsets[changedRect + 1]; i++)
+    {
+      auto light = rectLights.columns[i];
+      if (isLightChanged[light]) continue;
+
+      isLightChanged[light] = true;
+      changedLights.push_back(light);
+    }
   }
 
-  float2 center() const
+  mix_lights(samplingDescription.RectFactors, data, changedLights, targetColors);
+}
+
+std::filesystem::path _tracePath;
+
+BOOL WINAPI SaveTraceOnExit(DWORD /*controlType*/)
+{
+  try
+  {
+    trace_buffer::save(_tracePath);
+  }
+  catch (...)
   {
-    return (top_left + bottom_right) / 2.f;
+    printf("Failed to save the trace.\n");
   }
+
+  //Let the default handler end the process
+  return FALSE;
+}
+
+//Lights one display with its own controllers, each output has its own capture, mixing and output threads so their frame rates are independent
+struct output_pipeline
+{
+  const OutputSettings settings;
+  AdaLightControllerGroup controllers;
+  pipeline_latencies latencies;
+
+  output_pipeline(const OutputSettings& outputSettings) :
+    settings(outputSettings),
+    controllers(outputSettings.ControllerOptions, DisplaySettings::FromLayout(outputSettings.LightLayout).SamplePoints.size())
+  { }
 };
 
-struct SamplingDescription
+string GetOutputLabel(const OutputSettings& settings)
 {
-  std::vector<rect> Rects;
-  vector<vector<pair<uint16_t, float>>> RectFactors;
+  return settings.OutputName.empty() ? "default" : to_string(settings.OutputName);
+}
 
-  static SamplingDescription Create(const DisplaySettings& settings, size_t verticalDivisions = 16)
-  {
-    auto horizontalDivisions = size_t(verticalDivisions * settings.AspectRatio);
+//Runs the capture stage on the calling thread, returns once a stage of the output failed and all of its threads are stopped
+void RunOutput(const path& root, const Settings& settings, output_pipeline& pipeline)
+{
+  auto label = GetOutputLabel(pipeline.settings);
+  trace_buffer::name_thread(("capture " + label).c_str());
 
-    //
-    vector<rect> lightRects;
-    lightRects.reserve(settings.SamplePoints.size());
-    auto sampleOffset = settings.SampleSize / float2(2.f, -2.f);
-    for (auto& samplePoint : settings.SamplePoints)
-    {
-      lightRects.push_back({ samplePoint - sampleOffset, samplePoint + sampleOffset });
-    }
+  auto displaySettings = DisplaySettings::FromLayout(pipeline.settings.LightLayout);
+  auto samplingDescription = SamplingDescription::Create(displaySettings);
+  auto rectCount = samplingDescription.Rects.size();
+  auto lightCount = displaySettings.SamplePoints.size();
 
-    //
-    vector<vector<pair<uint16_t, float>>> lightsDisplayRectFactors(settings.SamplePoints.size());
+  vector<uint32_t> allRects(rectCount);
+  iota(allRects.begin(), allRects.end(), 0u);
 
-    vector<rect> displayRects;
-    displayRects.reserve(verticalDivisions * horizontalDivisions);
+  //Capture, mixing and output run on separate threads, each stage only ever picks up the newest result of the previous one
+  triple_buffer<sampled_frame> sampledFrames({ 0u, {}, vector<array<uint32_t, 4>>(rectCount), allRects });
+  triple_buffer<light_frame> lightFrames({ 0u, {}, vector<rgb>(lightCount) });
 
-    float2 step{ 1.f / horizontalDivisions, 1.f / verticalDivisions };
-    rect displayRect{ step.y, 0, 0, step.x };
-    for (size_t y = 0u; y < verticalDivisions; y++)
+  //A failing stage reports itself and stops the others, capture notices it after its current frame or when waiting for one times out
+  atomic<bool> isRunning = true;
+  auto runStage = [&](const char* name, const function<void()>& stage) {
+    try
     {
-      displayRect.left = 0;
-      displayRect.right = step.x;
+      stage();
+    }
+    catch (const hresult_canceled&)
+    {
+      //Stopped because another stage failed
+    }
+    catch (const hresult_error& error)
+    {
+      printf("The %s stage of output %s failed: %ls\n", name, label.c_str(), error.message().c_str());
+    }
+    catch (const exception& error)
+    {
+      printf("The %s stage of output %s failed: %s\n", name, label.c_str(), error.what());
+    }
 
-      for (size_t x = 0u; x < horizontalDivisions; x++)
+    isRunning = false;
+    sampledFrames.interrupt();
+  };
+
+  auto throwIfStopped = [&] {
+    if (!isRunning) throw hresult_canceled();
+  };
+
+  thread mixingThread([&] {
+    trace_buffer::name_thread(("mixing " + label).c_str());
+    runStage("mixing", [&] {
+      allocation_monitor allocationMonitor;
+      vector<bool> isLightChanged;
+      vector<uint32_t> changedLights;
+      changedLights.reserve(lightCount);
+      vector<rgb> targetColors(lightCount);
+      uint64_t lastFrameIndex = 0u;
+
+      while (isRunning)
       {
-        uint16_t lightIndex = 0u;
-        bool isUsed = false;
-        for (auto& sampleRect : lightRects)
+        if (!sampledFrames.wait_update()) continue;
+
+        allocationMonitor.begin_frame();
+
+        //If frames were skipped their changes are not in changed_rects, so everything is remixed
+        auto& frame = sampledFrames.front();
+        auto& changedRects = frame.index == lastFrameIndex + 1 ? frame.changed_rects : allRects;
+        lastFrameIndex = frame.index;
+
         {
-          if (sampleRect.intersects(displayRect))
-          {
-            isUsed = true;
+          latency_scope scope(pipeline.latencies.mixing, "mix", frame.index);
+          MixColors(samplingDescription, frame.sums, changedRects, isLightChanged, changedLights, targetColors);
+        }
 
-            auto weight = 1.f - length((displayRect.center() - sampleRect.center()) / 2.f / settings.SampleSize);
-            lightsDisplayRectFactors[lightIndex].push_back({ displayRects.size(), weight });
-          }
+        auto& lightFrame = lightFrames.back();
+        lightFrame.index = frame.index;
+        lightFrame.capture_time = frame.capture_time;
+        lightFrame.colors = targetColors;
+        lightFrames.publish();
+
+        allocationMonitor.end_frame();
+      }
+    });
+  });
+
+  thread outputThread([&] {
+    trace_buffer::name_thread(("output " + label).c_str());
+    runStage("output", [&] {
+      allocation_monitor allocationMonitor;
+      temporal_filter filter(settings.TemporalFilterOptions, lightCount);
+      vector<rgb> currentColors(lightCount);
+
+      auto lastStatistics = pipeline.controllers.GetStatistics();
+      auto nextReport = chrono::steady_clock::now() + 5s;
 
-          lightIndex++;
+      while (isRunning)
+      {
+        //Without new colors the lights keep fading towards the last ones
+        lightFrames.wait_update(17u);
+
+        allocationMonitor.begin_frame();
+
+        auto& lightFrame = lightFrames.front();
+        {
+          latency_scope scope(pipeline.latencies.filtering, "filter", lightFrame.index);
+          filter.update(lightFrame.colors, currentColors);
         }
 
-        if (isUsed)
         {
-          displayRects.push_back(displayRect);
+          latency_scope scope(pipeline.latencies.encoding, "encode", lightFrame.index);
+          pipeline.controllers.Push(currentColors, lightFrame.capture_time);
         }
 
-        displayRect.left += step.x;
-        displayRect.right += step.x;
+        allocationMonitor.end_frame();
+
+        auto now = chrono::steady_clock::now();
+        if (now >= nextReport)
+        {
+          auto statistics = pipeline.controllers.GetStatistics();
+          auto pushedFrames = statistics.PushedFrames - lastStatistics.PushedFrames;
+          auto coalescedFrames = statistics.CoalescedFrames - lastStatistics.CoalescedFrames;
+          auto droppedFrames = statistics.DroppedFrames - lastStatistics.DroppedFrames;
+          if (coalescedFrames > 0u || droppedFrames > 0u)
+          {
+            printf("Serial link of %s saturated: %llu of %llu frames coalesced, %llu dropped.\n", label.c_str(), coalescedFrames, pushedFrames, droppedFrames);
+          }
+
+          lastStatistics = statistics;
+          nextReport = now + 5s;
+        }
       }
+    });
+  });
+
+  vector<array<uint32_t, 4>> data;
+  uint64_t frameIndex = 0u;
+  allocation_monitor allocationMonitor;
+
+  auto publishSampledFrame = [&](const vector<uint32_t>& changedRects, chrono::steady_clock::time_point captureTime) {
+    if (changedRects.empty()) return;
+
+    auto& frame = sampledFrames.back();
+    frame.index = ++frameIndex;
+    frame.capture_time = captureTime;
+    frame.sums = data;
+    frame.changed_rects.assign(changedRects.begin(), changedRects.end());
+    sampledFrames.publish();
+  };
+
+  runStage("capture", [&] {
+    if (settings.FrameSourceOptions.Type != FrameSourceType::Desktop || settings.SamplingOptions.Mode != SamplerMode::Gpu)
+    {
+      auto frameSourceOptions = settings.FrameSourceOptions;
+      frameSourceOptions.OutputName = pipeline.settings.OutputName;
+      frameSourceOptions.Path = root / frameSourceOptions.Path;
 
-      displayRect.top += step.y;
-      displayRect.bottom += step.y;
+      auto frameSource = frame_source::create(frameSourceOptions);
+      frameSource->set_sampled_rects(samplingDescription.Rects);
+
+      auto cpuSampler = cpu_sampler(samplingDescription.Rects, settings.SamplingOptions);
+      while (isRunning)
+      {
+        allocationMonitor.begin_frame();
+
+        auto captureStart = chrono::steady_clock::now();
+        auto& frame = frameSource->lock_frame(1000u, throwIfStopped);
+        auto captureTime = chrono::steady_clock::now();
+        pipeline.latencies.capture_wait.record(captureTime - captureStart);
+        trace_buffer::record("capture", captureStart, captureTime, frameIndex + 1);
+
+        auto& changedRects = cpuSampler.run(frame, data);
+        auto samplingEnd = chrono::steady_clock::now();
+        pipeline.latencies.sampling.record(samplingEnd - captureTime);
+        trace_buffer::record("sample", captureTime, samplingEnd, frameIndex + 1);
+        frameSource->unlock_frame();
+
+        publishSampledFrame(changedRects, captureTime);
+
+        allocationMonitor.end_frame();
+      }
+      return;
     }
 
-    //
-    for (auto& lightDisplayRectFactors : lightsDisplayRectFactors)
+    auto output = get_output(pipeline.settings.OutputName);
+
+    DXGI_OUTPUT_DESC1 desc;
+    output.as<IDXGIOutput6>()->GetDesc1(&desc);
+
+    com_ptr<IDXGIAdapter> adapter;
+    check_hresult(output->GetParent(__uuidof(IDXGIAdapter), adapter.put_void()));
+
+#ifndef NDEBUG
+    auto window = create_debug_window();
+
+    d3d11_renderer_with_swap_chain renderer(adapter, window);
+
+    auto vertexShader = d3d11_vertex_shader(renderer.device, root / L"SimpleVertexShader.cso");
+    auto pixelShader = d3d11_pixel_shader(renderer.device, root / L"SimplePixelShader.cso");
+
+    auto quad = Primitives::make_quad(renderer.device);
+    vertexShader.set_input_layout(quad.vertex_buffer.input_desc());
+
+    auto blendState = d3d11_blend_state(renderer.device, d3d11_blend_type::opaque);
+    auto rasterizerState = d3d11_rasterizer_state(renderer.device, d3d11_rasterizer_type::cull_none);
+#else
+    d3d11_renderer renderer(adapter);
+#endif // NDEBUG  
+
+    auto duplication = d3d11_desktop_duplication(renderer.device, output);
+    auto sampler = d3d11_sampler_state(renderer.device, D3D11_FILTER_MIN_MAG_MIP_LINEAR, D3D11_TEXTURE_ADDRESS_CLAMP);
+    auto samplePoints = d3d11_structured_buffer<rect>::make_immutable(renderer.device, samplingDescription.Rects);
+    auto transferLut = transfer_lut(settings.SamplingOptions);
+    auto transferLutTexture = d3d11_texture_3d::make_immutable<array<uint16_t, 4>>(renderer.device, DXGI_FORMAT_R16G16B16A16_UNORM, transfer_lut::size, transfer_lut::size, transfer_lut::size, transferLut.entries);
+    auto ledColorSums = d3d11_structured_buffer<array<uint32_t, 4>>::make_writeable(renderer.device, samplingDescription.Rects.size());
+    auto samplerShader = d3d11_compute_shader(renderer.device, root / L"SamplerComputeShader.cso");
+    auto ledColorStage = d3d11_structured_buffer<array<uint32_t, 4>>::make_staging(renderer.device, samplingDescription.Rects.size());
+
+    while (isRunning)
     {
-      auto totalWeight = 0.f;
-      for (auto& displayRectFactor : lightDisplayRectFactors)
+      allocationMonitor.begin_frame();
+
+      auto captureStart = chrono::steady_clock::now();
+      auto& texture = duplication.lock_frame(1000u, throwIfStopped);
+      auto captureTime = chrono::steady_clock::now();
+      pipeline.latencies.capture_wait.record(captureTime - captureStart);
+      trace_buffer::record("capture", captureStart, captureTime, frameIndex + 1);
+
+#ifndef NDEBUG
+      auto& target = renderer.render_target();
+      target.set(renderer.context);
+      target.clear(renderer.context, { 1.f, 0.f, 0.f, 1.f });
+
+      vertexShader.set(renderer.context);
+      pixelShader.set(renderer.context);
+      texture.set(renderer.context, d3d11_shader_stage::ps);
+      sampler.set(renderer.context, d3d11_shader_stage::ps);
+      blendState.set(renderer.context);
+      rasterizerState.set(renderer.context);
+      quad.draw(renderer.context);
+#endif
+
+      //Dispatching only queues the work, the readback includes waiting for the GPU to run it
       {
-        totalWeight += displayRectFactor.second;
+        latency_scope scope(pipeline.latencies.sampling, "sample", frameIndex + 1);
+        texture.set(renderer.context, d3d11_shader_stage::cs);
+        samplePoints.set_readonly(renderer.context, 1);
+        transferLutTexture.set(renderer.context, d3d11_shader_stage::cs, 2);
+        ledColorSums.set_writeable(renderer.context);
+        samplerShader.run(renderer.context, (uint32_t)samplingDescription.Rects.size());
       }
 
-      for (auto& displayRectFactor : lightDisplayRectFactors)
       {
-        displayRectFactor.second /= totalWeight;
+        latency_scope scope(pipeline.latencies.readback, "readback", frameIndex + 1);
+        ledColorSums.copy_to(renderer.context, ledColorStage);
+        ledColorStage.get_data(renderer.context, data);
       }
-    }
 
-    return { displayRects, lightsDisplayRectFactors };
-  }
-};
+      publishSampledFrame(allRects, captureTime);
 
-void LerpColors(std::vector<AxoLight::Colors::rgb>& currentColors, const std::vector<AxoLight::Colors::rgb>& targetColors)
-{
-  auto it = currentColors.begin();
-  for (auto& color : targetColors)
-  {
-    *it++ = lerp(*it, color, 0.2f);
-  }
+#ifndef NDEBUG
+      renderer.swap_chain->Present(1, 0);
+#endif
+
+      duplication.unlock_frame();
+
+      allocationMonitor.end_frame();
+    }
+  });
+
+  mixingThread.join();
+  outputThread.join();
 }
 
 int main()
@@ -155,103 +415,79 @@ int main()
 
   auto root = get_root();
   auto settings = SettingsImporter::Parse(root / L"settings.json");
-  auto displaySettings = DisplaySettings::FromLayout(settings.LightLayout);
 
-  AdaLightController controller{ settings.ControllerOptions };
-  if (!controller.IsConnected()) return 0;
-
-  auto output = get_default_output();
-
-  DXGI_OUTPUT_DESC1 desc;
-  output.as<IDXGIOutput6>()->GetDesc1(&desc);
+  if (settings.TracingOptions.IsEnabled)
+  {
+    _tracePath = root / settings.TracingOptions.Path;
+    trace_buffer::start(settings.TracingOptions.Capacity);
+    SetConsoleCtrlHandler(SaveTraceOnExit, true);
+  }
 
-  com_ptr<IDXGIAdapter> adapter;
-  check_hresult(output->GetParent(__uuidof(IDXGIAdapter), adapter.put_void()));
+  auto outputs = settings.Outputs;
+  if (outputs.empty()) outputs.push_back({ {}, settings.ControllerOptions, settings.LightLayout });
 
-#ifndef NDEBUG
-  auto window = create_debug_window();
-
-  d3d11_renderer_with_swap_chain renderer(adapter, window);
+  vector<unique_ptr<output_pipeline>> pipelines;
+  for (auto& output : outputs)
+  {
+    if (settings.FrameSourceOptions.Type == FrameSourceType::Desktop && !get_output(output.OutputName))
+    {
+      printf("Output %s not found.\n", GetOutputLabel(output).c_str());
+      continue;
+    }
 
-  auto vertexShader = d3d11_vertex_shader(renderer.device, root / L"SimpleVertexShader.cso");
-  auto pixelShader = d3d11_pixel_shader(renderer.device, root / L"SimplePixelShader.cso");
+    for (auto& controllerOptions : output.ControllerOptions)
+    {
+      auto& calibrationPath = controllerOptions.CalibrationPath;
+      if (!calibrationPath.empty()) calibrationPath = root / calibrationPath;
+    }
 
-  auto quad = Primitives::make_quad(renderer.device);
-  vertexShader.set_input_layout(quad.vertex_buffer.input_desc());
+    unique_ptr<output_pipeline> pipeline;
+    try
+    {
+      pipeline = make_unique<output_pipeline>(output);
+    }
+    catch (const hresult_invalid_argument& error)
+    {
+      printf("Skipping output %s: %ls\n", GetOutputLabel(output).c_str(), error.message().c_str());
+      continue;
+    }
 
-  auto blendState = d3d11_blend_state(renderer.device, d3d11_blend_type::opaque);
-  auto rasterizerState = d3d11_rasterizer_state(renderer.device, d3d11_rasterizer_type::cull_none);
-#else
-  d3d11_renderer renderer(adapter);
-#endif // NDEBUG  
+    if (!pipeline->controllers.IsConnected())
+    {
+      printf("No controller connected for output %s.\n", GetOutputLabel(output).c_str());
+      continue;
+    }
 
-  auto duplication = d3d11_desktop_duplication(renderer.device, output);
-  auto sampler = d3d11_sampler_state(renderer.device, D3D11_FILTER_MIN_MAG_MIP_LINEAR, D3D11_TEXTURE_ADDRESS_CLAMP);
-  auto samplingDescription = SamplingDescription::Create(displaySettings);
-  auto samplePoints = d3d11_structured_buffer<rect>::make_immutable(renderer.device, samplingDescription.Rects);
-  auto ledColorSums = d3d11_structured_buffer<array<uint32_t, 4>>::make_writeable(renderer.device, samplingDescription.Rects.size());
-  auto samplerShader = d3d11_compute_shader(renderer.device, root / L"SamplerComputeShader.cso");
-  auto ledColorStage = d3d11_structured_buffer<array<uint32_t, 4>>::make_staging(renderer.device, samplingDescription.Rects.size());
-
-  std::vector<rgb> targetColors(displaySettings.SamplePoints.size());
-  std::vector<rgb> currentColors(displaySettings.SamplePoints.size());
-  while (true)
-  {
-    auto& texture = duplication.lock_frame(17u, [&] {
-      LerpColors(currentColors, targetColors);
-      controller.Push(currentColors);
-      });
+    pipelines.push_back(move(pipeline));
+  }
 
-#ifndef NDEBUG
-    auto& target = renderer.render_target();
-    target.set(renderer.context);
-    target.clear(renderer.context, { 1.f, 0.f, 0.f, 1.f });
-
-    vertexShader.set(renderer.context);
-    pixelShader.set(renderer.context);
-    texture.set(renderer.context, d3d11_shader_stage::ps);
-    sampler.set(renderer.context, d3d11_shader_stage::ps);
-    blendState.set(renderer.context);
-    rasterizerState.set(renderer.context);
-    quad.draw(renderer.context);
-#endif
+  if (pipelines.empty()) return 0;
 
-    //
-    sampler.set(renderer.context, d3d11_shader_stage::cs);
-    texture.set(renderer.context, d3d11_shader_stage::cs);
-    samplePoints.set_readonly(renderer.context, 1);
-    ledColorSums.set_writeable(renderer.context);
-    samplerShader.run(renderer.context, (uint32_t)samplingDescription.Rects.size());
-    ledColorSums.copy_to(renderer.context, ledColorStage);
-    auto data = ledColorStage.get_data(renderer.context);
-
-    auto it = targetColors.begin();
-    for (auto rectFactors : samplingDescription.RectFactors)
+  //The stages record their timings without locks, pressing enter prints a snapshot and saves the trace while the pipelines keep running
+  printf("Press enter to print the latency statistics.\n");
+  thread reportThread([&] {
+    while (getchar() != EOF)
     {
-      float3 color{};
-      for (auto& [cell, factor] : rectFactors)
+      for (auto& pipeline : pipelines)
       {
-        auto& sample = data[cell];
-
-        color += float3(sample[0], sample[1], sample[2]) * factor;
+        printf("Output %s\n", GetOutputLabel(pipeline->settings).c_str());
+        PrintLatencies(pipeline->latencies, pipeline->controllers);
       }
-
-      rgb newColor{ uint8_t(color.x), uint8_t(color.y), uint8_t(color.z) };
-      *it++ = newColor;
+      SaveTraceOnExit(0);
     }
+  });
+  reportThread.detach();
 
-    enhance(targetColors);
-
-    LerpColors(currentColors, targetColors);
-    controller.Push(currentColors);
-
-#ifndef NDEBUG
-    renderer.swap_chain->Present(1, 0);
-#endif
+  vector<thread> outputThreads;
+  for (auto& pipeline : pipelines)
+  {
+    outputThreads.emplace_back([&, pipeline = pipeline.get()] { RunOutput(root, settings, *pipeline); });
+  }
 
-    duplication.unlock_frame();
+  for (auto& outputThread : outputThreads)
+  {
+    outputThread.join();
   }
 
   return 0;
-}
-
+}
\ No newline at end of file
@@ -4,11 +4,22 @@
 
 #include <array>
 #include <vector>
+#include <numeric>
 #include <unordered_map>
 #include <thread>
+#include <mutex>
 #include <functional>
+#include <random>
 #include <filesystem>
 
+#include <winsock2.h>
+#include <ws2tcpip.h>
+
+#pragma comment(lib, "ws2_32.lib")
+
+#include <intrin.h>
+#include <immintrin.h>
+
 #include <dxgi1_6.h>
 #include <d3d11_4.h>
 
@@ -0,0 +1,1039 @@
+#include "pch.h"
+#include "AdaLightController.h"
+#include "AdaLightEncoder.h"
+#include "CpuSampler.h"
+#include "DisplaySettings.h"
+#include "FrameSources.h"
+#include "Infrastructure.h"
+#include "Metrics.h"
+#include "NetworkTransports.h"
+#include "Sampling.h"
+#include "Simd.h"
+#include "TemporalFilter.h"
+#include "TransferLut.h"
+
+using namespace AxoLight::Capture;
+using namespace AxoLight::Colors;
+using namespace AxoLight::Display;
+using namespace AxoLight::Infrastructure;
+using namespace AxoLight::Lighting;
+using namespace AxoLight::Sampling;
+using namespace AxoLight::Simd;
+
+using namespace std;
+using namespace std::chrono;
+
+using namespace winrt;
+using namespace winrt::Windows::Data::Json;
+
+//Parameter sweeps shared by the benchmarks
+const array<uint16_t, 5> _lightCounts = { 50, 143, 500, 1000, 2000 };
+const array<size_t, 3> _verticalDivisions = { 16, 64, 128 };
+const array<pair<uint32_t, uint32_t>, 4> _resolutions = { { { 1920, 1080 }, { 2560, 1440 }, { 3840, 2160 }, { 7680, 4320 } } };
+
+struct timing
+{
+  duration<double, micro> best, median;
+};
+
+template<typename TAction>
+timing measure(TAction&& action, uint32_t iterations)
+{
+  vector<duration<double, micro>> samples(iterations);
+  for (auto& sample : samples)
+  {
+    auto start = steady_clock::now();
+    action();
+    sample = steady_clock::now() - start;
+  }
+
+  sort(samples.begin(), samples.end());
+  return { samples.front(), samples[samples.size() / 2] };
+}
+
+//Collects the results of a run so they can be compared across releases
+struct benchmark_report
+{
+private:
+  JsonArray _results;
+  bool _isFailed = false;
+
+  static JsonObject make_object(initializer_list<pair<const wchar_t*, double>> values)
+  {
+    JsonObject result;
+    for (auto& [key, value] : values)
+    {
+      result.SetNamedValue(key, JsonValue::CreateNumberValue(value));
+    }
+    return result;
+  }
+
+public:
+  //Adds a result, the times are stored in microseconds next to the other metrics
+  void add(const wchar_t* name, initializer_list<pair<const wchar_t*, double>> parameters, const timing& time, initializer_list<pair<const wchar_t*, double>> metrics = {})
+  {
+    auto metricObject = make_object(metrics);
+    metricObject.SetNamedValue(L"bestUs", JsonValue::CreateNumberValue(time.best.count()));
+    metricObject.SetNamedValue(L"medianUs", JsonValue::CreateNumberValue(time.median.count()));
+
+    JsonObject result;
+    result.SetNamedValue(L"name", JsonValue::CreateStringValue(name));
+    result.SetNamedValue(L"parameters", make_object(parameters));
+    result.SetNamedValue(L"metrics", metricObject);
+    _results.Append(result);
+  }
+
+  void add(const wchar_t* name, initializer_list<pair<const wchar_t*, double>> parameters, initializer_list<pair<const wchar_t*, double>> metrics)
+  {
+    JsonObject result;
+    result.SetNamedValue(L"name", JsonValue::CreateStringValue(name));
+    result.SetNamedValue(L"parameters", make_object(parameters));
+    result.SetNamedValue(L"metrics", make_object(metrics));
+    _results.Append(result);
+  }
+
+  //Marks the run as failed when a check does not hold, the benchmark then exits with a non-zero code
+  bool check(bool isPassing)
+  {
+    _isFailed |= !isPassing;
+    return isPassing;
+  }
+
+  bool is_failed() const
+  {
+    return _isFailed;
+  }
+
+  void save(const filesystem::path& path) const
+  {
+    JsonObject machine;
+    machine.SetNamedValue(L"avx2", JsonValue::CreateBooleanValue(has_avx2()));
+    machine.SetNamedValue(L"avx512Vbmi", JsonValue::CreateBooleanValue(has_avx512_vbmi()));
+    machine.SetNamedValue(L"hardwareThreads", JsonValue::CreateNumberValue(thread::hardware_concurrency()));
+
+    JsonObject report;
+    report.SetNamedValue(L"formatVersion", JsonValue::CreateNumberValue(1));
+    report.SetNamedValue(L"machine", machine);
+    report.SetNamedValue(L"results", _results);
+
+    auto text = to_string(report.Stringify());
+
+    FILE* file = nullptr;
+    _wfopen_s(&file, path.c_str(), L"wb");
+    if (!file) throw hresult_invalid_argument(L"Cannot open the benchmark result file.");
+
+    fwrite(text.data(), 1, text.size(), file);
+    fclose(file);
+  }
+};
+
+DisplayLightLayout make_layout(uint16_t lightCount, float sampleSize)
+{
+  DisplayLightLayout layout{};
+  layout.DisplaySize = { 121.8f, 68.5f };
+  layout.StartPosition = { DisplayPositionReference::BottomRight, 2.f, 2.f };
+  layout.SampleSize = sampleSize;
+
+  auto sideCount = uint16_t(lightCount / 4);
+  layout.Segments = {
+    { { DisplayPositionReference::TopRight, 2.f, 2.f }, sideCount },
+    { { DisplayPositionReference::TopLeft, 2.f, 2.f }, sideCount },
+    { { DisplayPositionReference::BottomLeft, 2.f, 2.f }, sideCount },
+    { { DisplayPositionReference::BottomRight, 2.f, 2.f }, uint16_t(lightCount - 3 * sideCount) }
+  };
+  return layout;
+}
+
+//Denser strips get smaller sample areas, as they would on a real display
+DisplaySettings make_display_settings(uint16_t lightCount)
+{
+  return DisplaySettings::FromLayout(make_layout(lightCount, lightCount > 500 ? 2.f : 10.f));
+}
+
+vector<rgb> make_colors(size_t count, uint32_t seed)
+{
+  vector<rgb> colors(count);
+  for (size_t i = 0u; i < count; i++)
+  {
+    auto value = uint32_t(i + seed) * 0x9e3779b1u;
+    colors[i] = { uint8_t(value >> 24), uint8_t(value >> 16), uint8_t(value >> 8) };
+  }
+  return colors;
+}
+
+void benchmark_sampling_description(benchmark_report& report)
+{
+  printf("SamplingDescription::Create\n");
+  for (auto lightCount : _lightCounts)
+  {
+    auto displaySettings = make_display_settings(lightCount);
+    for (auto verticalDivisions : _verticalDivisions)
+    {
+      size_t rectCount = 0u, weightCount = 0u;
+      auto time = measure([&] {
+        auto description = SamplingDescription::Create(displaySettings, verticalDivisions);
+        rectCount = description.Rects.size();
+        weightCount = description.RectFactors.values.size();
+      }, 10);
+
+      printf("  %4u lights, %3zu rows: %9.3f ms (%zu cells, %zu weights)\n", lightCount, verticalDivisions, time.best.count() / 1000., rectCount, weightCount);
+      report.add(L"SamplingDescription::Create", { { L"lights", lightCount }, { L"rows", double(verticalDivisions) } }, time, { { L"cells", double(rectCount) }, { L"weights", double(weightCount) } });
+    }
+  }
+}
+
+void benchmark_light_mixing(benchmark_report& report)
+{
+  printf("mix_lights\n");
+  for (auto lightCount : _lightCounts)
+  {
+    auto displaySettings = make_display_settings(lightCount);
+    for (auto verticalDivisions : _verticalDivisions)
+    {
+      auto samplingDescription = SamplingDescription::Create(displaySettings, verticalDivisions);
+
+      vector<array<uint32_t, 4>> sums(samplingDescription.Rects.size());
+      for (size_t i = 0u; i < sums.size(); i++)
+      {
+        sums[i] = { uint32_t(i * 7 % 256), uint32_t(i * 13 % 256), uint32_t(i * 29 % 256), 1u };
+      }
+
+      vector<uint32_t> lights(lightCount);
+      iota(lights.begin(), lights.end(), 0u);
+      vector<rgb> colors(lightCount);
+
+      auto time = measure([&] { mix_lights(samplingDescription.RectFactors, sums, lights, colors); }, 1000);
+      printf("  %4u lights, %3zu rows: %9.3f us (%zu weights)\n", lightCount, verticalDivisions, time.best.count(), samplingDescription.RectFactors.values.size());
+      report.add(L"mix_lights", { { L"lights", lightCount }, { L"rows", double(verticalDivisions) } }, time, { { L"weights", double(samplingDescription.RectFactors.values.size()) } });
+    }
+  }
+}
+
+void benchmark_cpu_sampler(benchmark_report& report)
+{
+  printf("cpu_sampler\n");
+
+  SamplingOptions options;
+  options.IsIncremental = false;
+
+  auto summedAreaOptions = options;
+  summedAreaOptions.Mode = SamplerMode::SummedArea;
+
+  auto downscaledOptions = options;
+  downscaledOptions.IsDownscaled = true;
+
+  auto downscaledSummedAreaOptions = summedAreaOptions;
+  downscaledSummedAreaOptions.IsDownscaled = true;
+
+  auto lutTime = measure([&] { transfer_lut lut(options); }, 5);
+  printf("  transfer_lut: %9.3f ms\n", lutTime.best.count() / 1000.);
+  report.add(L"transfer_lut", {}, lutTime);
+
+  for (auto [width, height] : _resolutions)
+  {
+    //A pattern without flat areas, so the table lookups hit all over the lattice
+    vector<uint32_t> pixels(size_t(width) * height);
+    for (uint32_t y = 0u; y < height; y++)
+    {
+      for (uint32_t x = 0u; x < width; x++)
+      {
+        pixels[size_t(y) * width + x] = (x * 0x9e3779b1u) ^ (y * 0x85ebca77u);
+      }
+    }
+    frame_view frame{ (const uint8_t*)pixels.data(), width, height, width * 4 };
+
+    for (auto lightCount : _lightCounts)
+    {
+      auto samplingDescription = SamplingDescription::Create(make_display_settings(lightCount));
+      cpu_sampler sampler(samplingDescription.Rects, options);
+
+      vector<array<uint32_t, 4>> sums;
+      auto time = measure([&] { sampler.run(frame, sums); }, 20);
+
+      cpu_sampler summedAreaSampler(samplingDescription.Rects, summedAreaOptions);
+      auto summedAreaTime = measure([&] { summedAreaSampler.run(frame, sums); }, 20);
+
+      //Share of the frame the border bands cover, which is what the desktop source copies back
+      vector<RECT> boxes;
+      for (auto& rect : samplingDescription.Rects)
+      {
+        boxes.push_back(to_pixel_box(rect, width, height));
+      }
+
+      uint64_t bandArea = 0u;
+      for (auto& band : get_border_bands(boxes, width, height))
+      {
+        bandArea += uint64_t(band.right - band.left) * (band.bottom - band.top);
+      }
+      auto bandCoverage = double(bandArea) / (uint64_t(width) * height);
+
+      printf("  %4ux%4u, %4u lights: %9.3f ms, summed area %9.3f ms (%zu cells, bands %.1f%%)\n", width, height, lightCount, time.best.count() / 1000., summedAreaTime.best.count() / 1000., samplingDescription.Rects.size(), bandCoverage * 100.);
+      report.add(L"cpu_sampler::run", { { L"width", width }, { L"height", height }, { L"lights", lightCount } }, time, { { L"cells", double(samplingDescription.Rects.size()) } });
+      report.add(L"cpu_sampler::run (summed area)", { { L"width", width }, { L"height", height }, { L"lights", lightCount } }, summedAreaTime, { { L"cells", double(samplingDescription.Rects.size()) }, { L"bandCoverage", bandCoverage } });
+
+      //Downscaled sampling, compared against the full resolution results of the same mode
+      cpu_sampler downscaledSampler(samplingDescription.Rects, downscaledOptions);
+      vector<array<uint32_t, 4>> downscaledSums;
+      auto downscaledTime = measure([&] { downscaledSampler.run(frame, downscaledSums); }, 20);
+
+      cpu_sampler downscaledSummedAreaSampler(samplingDescription.Rects, downscaledSummedAreaOptions);
+      vector<array<uint32_t, 4>> downscaledSummedAreaSums;
+      auto downscaledSummedAreaTime = measure([&] { downscaledSummedAreaSampler.run(frame, downscaledSummedAreaSums); }, 20);
+
+      summedAreaSampler.run(frame, sums);
+      uint32_t maxError = 0u;
+      for (size_t i = 0u; i < sums.size(); i++)
+      {
+        for (auto channel = 0u; channel < 3u; channel++)
+        {
+          maxError = max(maxError, uint32_t(abs(int32_t(sums[i][channel]) - int32_t(downscaledSummedAreaSums[i][channel]))));
+        }
+      }
+
+      printf("  %4ux%4u, %4u lights: %9.3f ms, summed area %9.3f ms downscaled %ux (max error %u)\n", width, height, lightCount, downscaledTime.best.count() / 1000., downscaledSummedAreaTime.best.count() / 1000., 1u << downscaledSampler.get_level(), maxError);
+      report.add(L"cpu_sampler::run (downscaled)", { { L"width", width }, { L"height", height }, { L"lights", lightCount } }, downscaledTime, { { L"level", double(downscaledSampler.get_level()) } });
+      report.add(L"cpu_sampler::run (summed area, downscaled)", { { L"width", width }, { L"height", height }, { L"lights", lightCount } }, downscaledSummedAreaTime, { { L"level", double(downscaledSampler.get_level()) }, { L"maxError", double(maxError) } });
+    }
+  }
+
+  //The summed area table must match averaging every pixel of the box through the same table points.
+  //Noise hits all over the lattice, while a white 8K frame has the largest sums, every pixel adds 255 * 255 to each color.
+  for (auto [width, height, isWhite] : { tuple{ _resolutions.front().first, _resolutions.front().second, false }, tuple{ _resolutions.back().first, _resolutions.back().second, true } })
+  {
+    vector<uint32_t> pixels(size_t(width) * height);
+    for (size_t i = 0u; i < pixels.size(); i++)
+    {
+      pixels[i] = isWhite ? 0xffffffffu : uint32_t(i * 0x9e3779b1u);
+    }
+    frame_view frame{ (const uint8_t*)pixels.data(), width, height, width * 4 };
+
+    auto samplingDescription = SamplingDescription::Create(make_display_settings(143));
+    cpu_sampler sampler(samplingDescription.Rects, summedAreaOptions);
+    transfer_lut transferLut(summedAreaOptions);
+
+    vector<array<uint32_t, 4>> sums;
+    sampler.run(frame, sums);
+
+    uint32_t maxError = 0u;
+    for (size_t i = 0u; i < sums.size(); i++)
+    {
+      auto box = cpu_sampler::make_box(frame, samplingDescription.Rects[i]);
+      uint64_t r = 0u, g = 0u, b = 0u, w = 0u;
+      for (auto y = box.top; y < box.bottom; y++)
+      {
+        for (auto x = box.left; x < box.right; x++)
+        {
+          auto pixel = frame.row(y)[x];
+          auto& value = transferLut.at({ uint8_t(pixel >> 16), uint8_t(pixel >> 8), uint8_t(pixel) });
+          r += value[0];
+          g += value[1];
+          b += value[2];
+          w += value[3];
+        }
+      }
+
+      array<uint32_t, 4> expected = { 0u, 0u, 0u, 0u };
+      if (w > 0u) expected = { uint32_t(r / w), uint32_t(g / w), uint32_t(b / w), 1u };
+      for (auto channel = 0u; channel < 4u; channel++)
+      {
+        maxError = max(maxError, uint32_t(abs(int32_t(sums[i][channel]) - int32_t(expected[channel]))));
+      }
+    }
+
+    auto isPassing = report.check(maxError == 0u);
+    printf("  summed area vs exact box average, %4ux%4u %s: max error %u%s\n", width, height, isWhite ? "white" : "noise", maxError, isPassing ? "" : " (FAILED)");
+    report.add(L"cpu_sampler summed area accuracy", { { L"width", width }, { L"height", height }, { L"white", isWhite ? 1. : 0. } }, { { L"maxError", double(maxError) } });
+
+    //The grid sampler reads the nearest table point like the GPU sampler, it must stay within half a lattice step of transforming each sample exactly
+    cpu_sampler gridSampler(samplingDescription.Rects, options);
+    gridSampler.run(frame, sums);
+
+    uint32_t maxGridError = 0u;
+    for (size_t i = 0u; i < sums.size(); i++)
+    {
+      auto expected = cpu_sampler::sample(frame, samplingDescription.Rects[i], options);
+      for (auto channel = 0u; channel < 4u; channel++)
+      {
+        maxGridError = max(maxGridError, uint32_t(abs(int32_t(sums[i][channel]) - int32_t(expected[channel]))));
+      }
+    }
+
+    auto gridTolerance = transfer_lut::step / 2u;
+    auto isGridPassing = report.check(maxGridError <= gridTolerance);
+    printf("  grid vs exact transform, %4ux%4u %s: max error %u, tolerance %u%s\n", width, height, isWhite ? "white" : "noise", maxGridError, gridTolerance, isGridPassing ? "" : " (FAILED)");
+    report.add(L"cpu_sampler grid accuracy", { { L"width", width }, { L"height", height }, { L"white", isWhite ? 1. : 0. } }, { { L"maxError", double(maxGridError) } });
+  }
+}
+
+//Runs the CPU frame loop with a varying number of dirty rects, once warmed up it must not allocate. Allocations are only counted in debug builds.
+void benchmark_frame_allocations(benchmark_report& report)
+{
+  printf("frame loop allocations\n");
+
+  if (!is_counting_allocations())
+  {
+    printf("  skipped, allocations are only counted in debug builds\n");
+    return;
+  }
+
+  const uint32_t frameCount = 256u;
+  const size_t maxDirtyRects = 64u;
+
+  synthetic_frame_source frameSource(SyntheticPattern::MovingBars, 1920u, 1080u, 0u);
+  auto samplingDescription = SamplingDescription::Create(make_display_settings(143));
+  auto lightCount = samplingDescription.RectFactors.rows();
+
+  //Frames start with few dirty rects and get busier, so buffers sized on the first frames would have to grow later
+  vector<vector<RECT>> dirtyRects(frameCount);
+  for (uint32_t i = 0u; i < frameCount; i++)
+  {
+    auto count = size_t(i) * maxDirtyRects / frameCount;
+    for (size_t j = 0u; j < count; j++)
+    {
+      auto value = uint32_t(i * maxDirtyRects + j) * 0x9e3779b1u;
+      auto x = LONG(value % 1800u), y = LONG((value >> 16) % 1000u);
+      dirtyRects[i].push_back({ x, y, x + 120, y + 80 });
+    }
+  }
+
+  vector<uint32_t> lights(lightCount);
+  iota(lights.begin(), lights.end(), 0u);
+
+  for (auto [name, mode, isDownscaled] : { make_tuple("grid", SamplerMode::Cpu, false), make_tuple("summed area", SamplerMode::SummedArea, false), make_tuple("summed area, downscaled", SamplerMode::SummedArea, true) })
+  {
+    SamplingOptions options;
+    options.Mode = mode;
+    options.IsDownscaled = isDownscaled;
+
+    cpu_sampler sampler(samplingDescription.Rects, options);
+    temporal_filter filter(TemporalFilterOptions{}, lightCount);
+    vector<array<uint32_t, 4>> sums;
+    vector<rgb> targetColors(lightCount), colors(lightCount);
+
+    allocation_monitor allocationMonitor;
+    size_t allocationCount = 0u;
+    for (uint32_t i = 0u; i < frameCount; i++)
+    {
+      allocationMonitor.begin_frame();
+
+      auto frame = frameSource.lock_frame();
+      frame.dirty_rects = i > 0u ? &dirtyRects[i] : nullptr;
+      sampler.run(frame, sums);
+      frameSource.unlock_frame();
+
+      mix_lights(samplingDescription.RectFactors, sums, lights, targetColors);
+      filter.update(targetColors, milliseconds(16), colors);
+
+      allocationCount += allocationMonitor.end_frame();
+    }
+
+    auto isPassing = report.check(allocationCount == 0u);
+    printf("  %-24s %zu allocations after warm-up%s\n", name, allocationCount, isPassing ? "" : " (FAILED)");
+    report.add(L"frame loop allocations", { { L"mode", double(mode) }, { L"downscaled", isDownscaled ? 1. : 0. } }, { { L"allocations", double(allocationCount) } });
+  }
+}
+
+void benchmark_color_conversions(benchmark_report& report)
+{
+  printf("rgb_to_hsl / hsl_to_rgb\n");
+
+  //Every 24-bit color once
+  rgb_buffer colors;
+  colors.resize(1 << 24);
+  for (size_t i = 0u; i < colors.size(); i++)
+  {
+    colors.r[i] = uint8_t(i >> 16);
+    colors.g[i] = uint8_t(i >> 8);
+    colors.b[i] = uint8_t(i);
+  }
+
+  hsl_buffer hslColors;
+  rgb_buffer rgbColors;
+  rgb_to_hsl(colors, hslColors);
+  hsl_to_rgb(hslColors, rgbColors);
+
+  float maxHueError = 0.f, maxSaturationError = 0.f, maxLightnessError = 0.f;
+  int maxRgbError = 0;
+  for (size_t i = 0u; i < colors.size(); i++)
+  {
+    auto hslColor = rgb_to_hsl(rgb{ colors.r[i], colors.g[i], colors.b[i] });
+    maxHueError = max(maxHueError, abs(hslColor.h - hslColors.h[i]));
+    maxSaturationError = max(maxSaturationError, abs(hslColor.s - hslColors.s[i]));
+    maxLightnessError = max(maxLightnessError, abs(hslColor.l - hslColors.l[i]));
+
+    auto rgbColor = hsl_to_rgb(hsl{ hslColors.h[i], hslColors.s[i], hslColors.l[i] });
+    maxRgbError = max({ maxRgbError, abs(rgbColor.r - rgbColors.r[i]), abs(rgbColor.g - rgbColors.g[i]), abs(rgbColor.b - rgbColors.b[i]) });
+  }
+
+  //Float rounding differs between the kernels, anything beyond that is a bug in the batch path
+  const float hueTolerance = 0.01f, saturationTolerance = 0.0001f, lightnessTolerance = 0.0001f;
+  const int rgbTolerance = 1;
+
+  auto isPassing = report.check(maxHueError <= hueTolerance && maxSaturationError <= saturationTolerance && maxLightnessError <= lightnessTolerance && maxRgbError <= rgbTolerance);
+  printf("  max error vs scalar: h %g, s %g, l %g, rgb %d%s\n", maxHueError, maxSaturationError, maxLightnessError, maxRgbError, isPassing ? "" : " (FAILED)");
+  report.add(L"color_conversion_error", {}, { { L"hue", maxHueError }, { L"saturation", maxSaturationError }, { L"lightness", maxLightnessError }, { L"rgb", maxRgbError } });
+
+  auto pixelCount = double(colors.size());
+  auto batchToHsl = measure([&] { rgb_to_hsl(colors, hslColors); }, 5);
+  auto batchToRgb = measure([&] { hsl_to_rgb(hslColors, rgbColors); }, 5);
+  auto scalarToHsl = measure([&] {
+    for (size_t i = 0u; i < colors.size(); i++)
+    {
+      auto hslColor = rgb_to_hsl(rgb{ colors.r[i], colors.g[i], colors.b[i] });
+      hslColors.h[i] = hslColor.h;
+      hslColors.s[i] = hslColor.s;
+      hslColors.l[i] = hslColor.l;
+    }
+  }, 5);
+  auto scalarToRgb = measure([&] {
+    for (size_t i = 0u; i < colors.size(); i++)
+    {
+      auto rgbColor = hsl_to_rgb(hsl{ hslColors.h[i], hslColors.s[i], hslColors.l[i] });
+      rgbColors.r[i] = rgbColor.r;
+      rgbColors.g[i] = rgbColor.g;
+      rgbColors.b[i] = rgbColor.b;
+    }
+  }, 5);
+
+  auto nanosecondsPerPixel = [&](const timing& time) { return time.best.count() * 1000. / pixelCount; };
+  printf("  rgb_to_hsl: %6.2f ns/pixel batch, %6.2f ns/pixel scalar\n", nanosecondsPerPixel(batchToHsl), nanosecondsPerPixel(scalarToHsl));
+  printf("  hsl_to_rgb: %6.2f ns/pixel batch, %6.2f ns/pixel scalar\n", nanosecondsPerPixel(batchToRgb), nanosecondsPerPixel(scalarToRgb));
+
+  report.add(L"rgb_to_hsl", { { L"pixels", pixelCount }, { L"batch", 1 } }, batchToHsl, { { L"nsPerPixel", nanosecondsPerPixel(batchToHsl) } });
+  report.add(L"rgb_to_hsl", { { L"pixels", pixelCount }, { L"batch", 0 } }, scalarToHsl, { { L"nsPerPixel", nanosecondsPerPixel(scalarToHsl) } });
+  report.add(L"hsl_to_rgb", { { L"pixels", pixelCount }, { L"batch", 1 } }, batchToRgb, { { L"nsPerPixel", nanosecondsPerPixel(batchToRgb) } });
+  report.add(L"hsl_to_rgb", { { L"pixels", pixelCount }, { L"batch", 0 } }, scalarToRgb, { { L"nsPerPixel", nanosecondsPerPixel(scalarToRgb) } });
+}
+
+void benchmark_output(benchmark_report& report)
+{
+  printf("Output stages\n");
+
+  array<uint8_t, 256> gamma;
+  for (auto i = 0u; i < 256u; i++)
+  {
+    gamma[i] = uint8_t(lroundf(powf(i / 255.f, 2.8f) * 255.f));
+  }
+
+  for (auto lightCount : _lightCounts)
+  {
+    auto colors = make_colors(lightCount, 0u);
+    auto targets = make_colors(lightCount, 7u);
+    vector<rgb> results(lightCount);
+
+    //Enhance returns early unless the average lightness is above its 0.7 limit, so it is timed on bright colors, which average about 0.87.
+    //The copy restores them before every iteration, as the scaling would bring them under the limit.
+    auto brightColors = colors;
+    for (auto& color : brightColors)
+    {
+      color = { uint8_t(color.r | 0xc0), uint8_t(color.g | 0xc0), uint8_t(color.b | 0xc0) };
+    }
+    auto enhanceTime = measure([&] { results = brightColors; enhance(results); }, 1000);
+
+    auto lerpTime = measure([&] {
+      for (size_t i = 0u; i < colors.size(); i++)
+      {
+        results[i] = lerp(colors[i], targets[i], 0.25f);
+      }
+    }, 1000);
+
+    printf("  %4u lights: enhance %8.3f us, lerp %8.3f us", lightCount, enhanceTime.best.count(), lerpTime.best.count());
+    report.add(L"enhance", { { L"lights", lightCount } }, enhanceTime);
+    report.add(L"lerp", { { L"lights", lightCount } }, lerpTime);
+
+    for (auto [type, name] : { pair{ TemporalFilterType::Exponential, L"Exponential" }, pair{ TemporalFilterType::CriticallyDamped, L"CriticallyDamped" }, pair{ TemporalFilterType::OneEuro, L"OneEuro" } })
+    {
+      TemporalFilterOptions options;
+      options.Type = type;
+      temporal_filter filter(options, lightCount);
+
+      auto step = duration_cast<steady_clock::duration>(duration<double, milli>(1000. / 60.));
+      auto time = measure([&] { filter.update(targets, step, results); swap(colors, targets); }, 1000);
+
+      printf(", %ls %8.3f us", name, time.best.count());
+      report.add(L"temporal_filter::update", { { L"lights", lightCount }, { L"type", double(type) } }, time);
+    }
+
+    adalight_encoder encoder(gamma);
+    vector<uint8_t> frame;
+    auto encodeTime = measure([&] { encoder.encode(colors, frame); }, 1000);
+
+    printf(", encode %8.3f us\n", encodeTime.best.count());
+    report.add(L"adalight_encoder::encode", { { L"lights", lightCount } }, encodeTime, { { L"bytes", double(frame.size()) } });
+  }
+}
+
+//Waits until the given time, sleeping while far from it and yielding close to it so the wake up is not a scheduler tick late
+void wait_until(steady_clock::time_point time)
+{
+  while (time - steady_clock::now() > milliseconds(2))
+  {
+    this_thread::sleep_for(milliseconds(1));
+  }
+
+  while (steady_clock::now() < time)
+  {
+    this_thread::yield();
+  }
+}
+
+//Emulates an AdaLight board on the other end of a named pipe. Bytes are taken no faster than the serial line would deliver them,
+//frames are validated the way the Arduino sketch does, and each frame is latched once the strip data has been shifted out.
+struct adalight_device_emulator
+{
+private:
+  static const size_t fifo_size = 32u;
+
+  size_t _lightCount;
+  steady_clock::duration _byteTime;
+  steady_clock::duration _showTime;
+  function<void(const uint8_t*, steady_clock::time_point)> _latchCallback;
+
+  vector<uint8_t> _frame;
+  steady_clock::time_point _lineTime;
+  steady_clock::time_point _showEnd;
+
+  //Returns false if the bytes received so far cannot be the start of a frame, and counts the reason
+  bool check_header()
+  {
+    auto header = _frame.data();
+    auto size = _frame.size();
+    if ((size > 0 && header[0] != 0x41) || (size > 1 && header[1] != 0x64) || (size > 2 && header[2] != 0x61))
+    {
+      framing_errors++;
+      return false;
+    }
+
+    if (size < 6) return true;
+    if (header[5] != uint8_t(header[3] ^ header[4] ^ 0x55))
+    {
+      checksum_errors++;
+      return false;
+    }
+
+    if ((size_t(header[3]) << 8 | header[4]) + 1 != _lightCount)
+    {
+      framing_errors++;
+      return false;
+    }
+
+    return true;
+  }
+
+  void receive(uint8_t value, steady_clock::time_point time)
+  {
+    //The sketch has interrupts disabled while writing the strip, so this byte would be lost on a real board
+    if (time < _showEnd) overrun_bytes++;
+
+    _frame.push_back(value);
+    while (!_frame.empty() && !check_header())
+    {
+      _frame.erase(_frame.begin());
+    }
+
+    if (_frame.size() == 6 + _lightCount * 3)
+    {
+      _showEnd = time + _showTime;
+      frames++;
+      if (_latchCallback) _latchCallback(_frame.data() + 6, _showEnd);
+      _frame.clear();
+    }
+  }
+
+public:
+  uint64_t frames = 0u;
+  uint64_t framing_errors = 0u;
+  uint64_t checksum_errors = 0u;
+  uint64_t overrun_bytes = 0u;
+
+  //The show time is spent per light after the last byte, 30 us matches a WS2812 strip
+  adalight_device_emulator(size_t lightCount, uint32_t baudRate, microseconds showTimePerLight = microseconds(30), function<void(const uint8_t*, steady_clock::time_point)> latchCallback = nullptr) :
+    _lightCount(lightCount),
+    _byteTime(AdaLightController::GetWireTime(1, baudRate)),
+    _showTime(showTimePerLight * lightCount),
+    _latchCallback(move(latchCallback))
+  {
+    _frame.reserve(6 + lightCount * 3);
+  }
+
+  //Creates the pipe the controller connects to, it only buffers what the serial bridge would, so the writer is held back by the line rate
+  static file_handle create_pipe(const wchar_t* name)
+  {
+    file_handle pipe(CreateNamedPipeW(name, PIPE_ACCESS_INBOUND, PIPE_TYPE_BYTE | PIPE_WAIT, 1, 0, DWORD(fifo_size), 0, nullptr));
+    if (!pipe) throw_last_error();
+    return pipe;
+  }
+
+  //Serves the pipe until the controller disconnects
+  void run(HANDLE pipe)
+  {
+    ConnectNamedPipe(pipe, nullptr);
+
+    array<uint8_t, fifo_size> buffer;
+    DWORD readSize;
+    while (ReadFile(pipe, buffer.data(), DWORD(buffer.size()), &readSize, nullptr) && readSize > 0)
+    {
+      //Bytes start on the line once they were written and the previous ones are through
+      auto now = steady_clock::now();
+      for (DWORD i = 0u; i < readSize; i++)
+      {
+        _lineTime = max(_lineTime, now) + _byteTime;
+        receive(buffer[i], _lineTime);
+      }
+
+      wait_until(_lineTime);
+    }
+  }
+};
+
+void benchmark_serial_loopback(benchmark_report& report)
+{
+  printf("AdaLightController loopback\n");
+  auto pipeName = L"\\\\.\\pipe\\AxoLightLoopback";
+  for (auto latchMargin : { microseconds(2500), microseconds(0) })
+  {
+    for (size_t lightCount : { 143, 600 })
+    {
+      AdaLightOptions options;
+      options.Transport = SerialTransportType::Port;
+      options.PortName = pipeName;
+      options.LatchMargin = latchMargin;
+
+      auto pipe = adalight_device_emulator::create_pipe(pipeName);
+      adalight_device_emulator device(lightCount, options.BaudRate);
+      thread deviceThread([&] { device.run(pipe.get()); });
+
+      AdaLightStatistics statistics;
+      auto runTime = seconds(2);
+      {
+        AdaLightController controller{ options };
+
+        vector<rgb> colors(lightCount);
+        auto end = steady_clock::now() + runTime;
+        for (uint8_t value = 0u; steady_clock::now() < end; value++)
+        {
+          fill(colors.begin(), colors.end(), rgb{ value, value, value });
+          controller.Push(colors);
+          this_thread::sleep_for(milliseconds(1));
+        }
+
+        statistics = controller.GetStatistics();
+      }
+
+      deviceThread.join();
+      auto frameTime = AdaLightController::GetWireTime(6 + lightCount * 3, options.BaudRate) + latchMargin;
+      printf("  %4zu lights, %4lld us latch margin: %7.1f fps received (%7.1f modelled), %llu framing errors, %llu checksum errors, %llu of %llu frames coalesced, %llu dropped\n",
+        lightCount, latchMargin.count(), device.frames / duration<double>(runTime).count(), 1. / duration<double>(frameTime).count(), device.framing_errors, device.checksum_errors,
+        statistics.CoalescedFrames, statistics.PushedFrames, statistics.DroppedFrames);
+      report.add(L"serial_loopback", { { L"lights", double(lightCount) }, { L"latchMarginUs", double(latchMargin.count()) } }, {
+        { L"receivedFps", device.frames / duration<double>(runTime).count() },
+        { L"modelledFps", 1. / duration<double>(frameTime).count() },
+        { L"framingErrors", double(device.framing_errors) },
+        { L"checksumErrors", double(device.checksum_errors) },
+        { L"overrunBytes", double(device.overrun_bytes) },
+        { L"coalescedFrames", double(statistics.CoalescedFrames) },
+        { L"droppedFrames", double(statistics.DroppedFrames) } });
+    }
+  }
+}
+
+//Pairs the brightness flips of a flashing frame source with the frames the device latches, the first state seen on either side is not a flip
+struct flash_latency_probe
+{
+private:
+  mutex _mutex;
+  vector<pair<steady_clock::time_point, bool>> _flips;
+  int _generatedState = -1;
+  int _latchedState = -1;
+
+public:
+  latency_histogram latencies;
+
+  void generate(bool isLit, steady_clock::time_point time)
+  {
+    if (_generatedState == int(isLit)) return;
+
+    lock_guard<mutex> lock(_mutex);
+    if (_generatedState >= 0) _flips.emplace_back(time, isLit);
+    _generatedState = isLit;
+  }
+
+  void latch(bool isLit, steady_clock::time_point time)
+  {
+    if (_latchedState == int(isLit)) return;
+
+    auto isFirst = _latchedState < 0;
+    _latchedState = isLit;
+    if (isFirst) return;
+
+    //Flips coalesced away before reaching the device are skipped
+    lock_guard<mutex> lock(_mutex);
+    auto flip = find_if(_flips.begin(), _flips.end(), [&](auto& item) { return item.second == isLit; });
+    if (flip == _flips.end()) return;
+
+    latencies.record(time - flip->first);
+    _flips.erase(_flips.begin(), flip + 1);
+  }
+};
+
+void benchmark_end_to_end_latency(benchmark_report& report)
+{
+  printf("Frame generation to LED latch\n");
+  auto pipeName = L"\\\\.\\pipe\\AxoLightLatency";
+  for (uint16_t lightCount : { 143, 600 })
+  {
+    AdaLightOptions options;
+    options.Transport = SerialTransportType::Port;
+    options.PortName = pipeName;
+
+    flash_latency_probe probe;
+    auto pipe = adalight_device_emulator::create_pipe(pipeName);
+    adalight_device_emulator device(lightCount, options.BaudRate, microseconds(30), [&](const uint8_t* colors, steady_clock::time_point time) {
+      probe.latch(colors[0] || colors[1] || colors[2], time);
+    });
+    thread deviceThread([&] { device.run(pipe.get()); });
+
+    SamplingOptions samplingOptions;
+    samplingOptions.IsIncremental = false;
+    auto samplingDescription = SamplingDescription::Create(make_display_settings(lightCount));
+    cpu_sampler sampler(samplingDescription.Rects, samplingOptions);
+
+    vector<uint32_t> lights(lightCount);
+    iota(lights.begin(), lights.end(), 0u);
+    vector<array<uint32_t, 4>> sums;
+    vector<rgb> colors(lightCount);
+
+    //The flash pattern flips every 30 frames
+    auto runTime = seconds(8);
+    {
+      AdaLightController controller{ options };
+      synthetic_frame_source source(SyntheticPattern::Flash, 1280, 720, 240);
+
+      auto end = steady_clock::now() + runTime;
+      while (steady_clock::now() < end)
+      {
+        auto& frame = source.lock_frame();
+        auto generationTime = steady_clock::now();
+        probe.generate((frame.row(0)[0] & 0xffffffu) != 0u, generationTime);
+
+        sampler.run(frame, sums);
+        source.unlock_frame();
+
+        mix_lights(samplingDescription.RectFactors, sums, lights, colors);
+        controller.Push(colors, generationTime);
+      }
+    }
+
+    deviceThread.join();
+
+    auto latency = probe.latencies.snapshot();
+    printf("  %4u lights: %llu flips, mean %6lld us, p50 %6lld us, p99 %6lld us, max %6lld us, %llu framing errors, %llu checksum errors, %llu overrun bytes\n",
+      lightCount, latency.count, latency.mean.count(), latency.p50.count(), latency.p99.count(), latency.max.count(), device.framing_errors, device.checksum_errors, device.overrun_bytes);
+    report.add(L"end_to_end_latency", { { L"lights", lightCount }, { L"baudRate", double(options.BaudRate) } }, {
+      { L"flips", double(latency.count) },
+      { L"meanUs", double(latency.mean.count()) },
+      { L"p50Us", double(latency.p50.count()) },
+      { L"p99Us", double(latency.p99.count()) },
+      { L"maxUs", double(latency.max.count()) },
+      { L"latchedFrames", double(device.frames) },
+      { L"framingErrors", double(device.framing_errors) },
+      { L"checksumErrors", double(device.checksum_errors) },
+      { L"overrunBytes", double(device.overrun_bytes) } });
+  }
+}
+
+//Receives DDP or E1.31 packets on a loopback port, counts them and timestamps every completed frame
+struct udp_loopback_receiver
+{
+private:
+  SOCKET _socket;
+  SerialTransportType _protocol;
+  size_t _packetsPerFrame;
+  thread _thread;
+
+  void receive(const function<void(bool, steady_clock::time_point)>& frameCallback)
+  {
+    vector<uint8_t> buffer(65536);
+    auto isLit = false;
+    while (true)
+    {
+      auto size = recv(_socket, (char*)buffer.data(), int(buffer.size()), 0);
+      if (size <= 0) break;
+
+      auto packet = buffer.data();
+      bool isFirst, isLast;
+      const uint8_t* colors;
+      if (_protocol == SerialTransportType::Ddp)
+      {
+        if (size < int(ddp_transport::header_size) || (packet[0] & 0xc0) != 0x40)
+        {
+          invalid_packets++;
+          continue;
+        }
+
+        isFirst = (uint32_t(packet[4]) << 24 | uint32_t(packet[5]) << 16 | uint32_t(packet[6]) << 8 | packet[7]) == 0u;
+        isLast = (packet[0] & 0x01) != 0;
+        colors = packet + ddp_transport::header_size;
+      }
+      else
+      {
+        if (size < int(e131_transport::header_size) || memcmp(packet + 4, "ASC-E1.17", 9) != 0)
+        {
+          invalid_packets++;
+          continue;
+        }
+
+        auto universeIndex = (size_t(packet[113]) << 8 | packet[114]) - 1u;
+        isFirst = universeIndex == 0u;
+        isLast = universeIndex + 1 == _packetsPerFrame;
+        colors = packet + e131_transport::header_size;
+      }
+
+      packets++;
+      if (isFirst) isLit = colors[0] || colors[1] || colors[2];
+      if (isLast)
+      {
+        frames++;
+        frameCallback(isLit, steady_clock::now());
+      }
+    }
+  }
+
+public:
+  atomic<uint64_t> packets = 0u;
+  atomic<uint64_t> frames = 0u;
+  atomic<uint64_t> invalid_packets = 0u;
+  uint16_t port = 0u;
+
+  udp_loopback_receiver(SerialTransportType protocol, size_t packetsPerFrame, function<void(bool, steady_clock::time_point)> frameCallback) :
+    _protocol(protocol),
+    _packetsPerFrame(packetsPerFrame)
+  {
+    _socket = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (_socket == INVALID_SOCKET) throw_last_error();
+
+    //Large enough for a burst of frames, so losses point at the sender rather than this reader
+    int bufferSize = 1 << 23;
+    setsockopt(_socket, SOL_SOCKET, SO_RCVBUF, (const char*)&bufferSize, sizeof(bufferSize));
+
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(_socket, (const sockaddr*)&address, sizeof(address)) != 0) throw_last_error();
+
+    int addressSize = sizeof(address);
+    getsockname(_socket, (sockaddr*)&address, &addressSize);
+    port = ntohs(address.sin_port);
+
+    _thread = thread([this, frameCallback = move(frameCallback)] { receive(frameCallback); });
+  }
+
+  ~udp_loopback_receiver()
+  {
+    closesocket(_socket);
+    _thread.join();
+  }
+};
+
+void benchmark_network_loopback(benchmark_report& report)
+{
+  printf("Network output loopback\n");
+
+  WSADATA data;
+  check_win32(WSAStartup(MAKEWORD(2, 2), &data));
+
+  for (auto [protocol, name] : { pair{ SerialTransportType::Ddp, L"Ddp" }, pair{ SerialTransportType::E131, L"E131" } })
+  {
+    for (size_t lightCount : { 143, 600, 2000 })
+    {
+      auto payloadSize = protocol == SerialTransportType::Ddp ? ddp_transport::payload_size : e131_transport::payload_size;
+      auto packetsPerFrame = (lightCount * 3 + payloadSize - 1) / payloadSize;
+
+      flash_latency_probe probe;
+      AdaLightStatistics statistics;
+      AdaLightLatencies latencies;
+      uint64_t receivedPackets, receivedFrames, invalidPackets;
+      bool isSegmenting;
+      auto runTime = seconds(2);
+      {
+        udp_loopback_receiver receiver(protocol, packetsPerFrame, [&](bool isLit, steady_clock::time_point time) { probe.latch(isLit, time); });
+
+        AdaLightOptions options;
+        options.Transport = protocol;
+        options.Address = L"127.0.0.1";
+        options.NetworkPort = receiver.port;
+        options.LatchMargin = microseconds(0);
+
+        isSegmenting = static_cast<udp_transport&>(*serial_transport::create(options)).is_segmenting();
+        {
+          AdaLightController controller{ options };
+
+          vector<rgb> colors(lightCount);
+          auto end = steady_clock::now() + runTime;
+          for (uint32_t i = 0u; steady_clock::now() < end; i++)
+          {
+            auto isLit = (i / 8u) % 2u == 0u;
+            fill(colors.begin(), colors.end(), isLit ? rgb{ 255, 255, 255 } : rgb{ 0, 0, 0 });
+
+            auto pushTime = steady_clock::now();
+            probe.generate(isLit, pushTime);
+            controller.Push(colors, pushTime);
+            this_thread::sleep_for(milliseconds(1));
+          }
+
+          statistics = controller.GetStatistics();
+          latencies = controller.GetLatencies();
+        }
+
+        //Let the last packets arrive
+        this_thread::sleep_for(milliseconds(50));
+        receivedPackets = receiver.packets;
+        receivedFrames = receiver.frames;
+        invalidPackets = receiver.invalid_packets;
+      }
+
+      auto sentPackets = statistics.WrittenFrames * packetsPerFrame;
+      auto lostPackets = sentPackets > receivedPackets ? sentPackets - receivedPackets : 0u;
+      auto latency = probe.latencies.snapshot();
+      printf("  %ls %4zu lights, %zu packets per frame%s: %7.1f fps received, send p50 %5lld us, push to receive p50 %5lld us p99 %5lld us, %llu of %llu packets lost, %llu invalid\n",
+        name, lightCount, packetsPerFrame, isSegmenting ? " (segmented)" : "", receivedFrames / duration<double>(runTime).count(), latencies.Write.p50.count(),
+        latency.p50.count(), latency.p99.count(), lostPackets, sentPackets, invalidPackets);
+      report.add(L"network_loopback", { { L"protocol", double(protocol) }, { L"lights", double(lightCount) } }, {
+        { L"receivedFps", receivedFrames / duration<double>(runTime).count() },
+        { L"packetsPerFrame", double(packetsPerFrame) },
+        { L"segmented", isSegmenting ? 1. : 0. },
+        { L"sendP50Us", double(latencies.Write.p50.count()) },
+        { L"latencyP50Us", double(latency.p50.count()) },
+        { L"latencyP99Us", double(latency.p99.count()) },
+        { L"sentPackets", double(sentPackets) },
+        { L"lostPackets", double(lostPackets) },
+        { L"invalidPackets", double(invalidPackets) } });
+    }
+  }
+
+  WSACleanup();
+}
+
+//Usage: AxoLightBenchmark [result path], the results are written as JSON to benchmark.json by default
+int main(int argc, char** argv)
+{
+  init_apartment();
+
+  benchmark_report report;
+  benchmark_sampling_description(report);
+  benchmark_light_mixing(report);
+  benchmark_cpu_sampler(report);
+  benchmark_frame_allocations(report);
+  benchmark_color_conversions(report);
+  benchmark_output(report);
+  benchmark_serial_loopback(report);
+  benchmark_end_to_end_latency(report);
+  benchmark_network_loopback(report);
+
+  auto path = filesystem::path(argc > 1 ? argv[1] : "benchmark.json");
+  report.save(path);
+  printf("Results saved to %s\n", path.string().c_str());
+
+  if (report.is_failed()) printf("Some checks FAILED\n");
+  return report.is_failed() ? 1 : 0;
+}
\ No newline at end of file
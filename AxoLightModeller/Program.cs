@@ -72,13 +72,9 @@ namespace AxoLightModeller
       public float NB1 { get; set; }
     }
 
-    static void Main(string[] args)
+    static IEstimator<ITransformer> MakePipeline(MLContext mlContext, string label)
     {
-      var mlContext = new MLContext();
-      var trainingData = mlContext.Data.LoadFromTextFile<RawColorData>(@"D:\Axodox\Documents\rgbMapping.csv", ',');
-
-
-      var pipeline = mlContext.Transforms.Conversion.ConvertType(new[]
+      return mlContext.Transforms.Conversion.ConvertType(new[]
       {
         new InputOutputColumnPair("NR0", "R0"),
         new InputOutputColumnPair("NG0", "G0"),
@@ -93,10 +89,62 @@ namespace AxoLightModeller
         .Append(mlContext.Transforms.Expression("NR1", "NR1 => NR1 / 255", "NR1"))
         .Append(mlContext.Transforms.Expression("NG1", "NG1 => NG1 / 255", "NG1"))
         .Append(mlContext.Transforms.Expression("NB1", "NB1 => NB1 / 255", "NB1"))
-        .Append(mlContext.Transforms.CopyColumns("Label", "NB1"))
+        .Append(mlContext.Transforms.CopyColumns("Label", label))
         .Append(mlContext.Transforms.Concatenate("Features", "NR0", "NG0", "NB0"))
         .Append(mlContext.Transforms.SelectColumns("Label", "Features"))
         .Append(mlContext.Regression.Trainers.LbfgsPoissonRegression());
+    }
+
+    //Fits a model per LED channel and writes its predictions on a lattice as an AxoLight calibration file
+    static void ExportCalibrationLut(MLContext mlContext, IDataView trainingData, string path, int size = 18)
+    {
+      //Lattice point i sits at color level i * 255 / (size - 1), the reader interpolates between them on that spacing
+      if (size < 2 || size > 256) throw new ArgumentOutOfRangeException(nameof(size));
+      byte ToLevel(int i) => (byte)Math.Round(i * 255.0 / (size - 1));
+
+      var points = new RawColorData[size * size * size];
+      for (var r = 0; r < size; r++)
+      {
+        for (var g = 0; g < size; g++)
+        {
+          for (var b = 0; b < size; b++)
+          {
+            points[(r * size + g) * size + b] = new RawColorData()
+            {
+              R0 = ToLevel(r),
+              G0 = ToLevel(g),
+              B0 = ToLevel(b)
+            };
+          }
+        }
+      }
+      var pointData = mlContext.Data.LoadFromEnumerable(points);
+
+      var channels = new[] { "NR1", "NG1", "NB1" }
+        .Select(label => MakePipeline(mlContext, label).Fit(trainingData).Transform(pointData).GetColumn<float>("Score").ToArray())
+        .ToArray();
+
+      using (var writer = new BinaryWriter(File.Create(path)))
+      {
+        writer.Write(0x4c435841u); //AXCL
+        writer.Write((uint)size);
+        for (var i = 0; i < points.Length; i++)
+        {
+          foreach (var channel in channels)
+          {
+            writer.Write((byte)Math.Clamp(Math.Round(channel[i] * 255), 0, 255));
+          }
+        }
+      }
+    }
+
+    static void Main(string[] args)
+    {
+      var mlContext = new MLContext();
+      var trainingData = mlContext.Data.LoadFromTextFile<RawColorData>(@"D:\Axodox\Documents\rgbMapping.csv", ',');
+
+
+      var pipeline = MakePipeline(mlContext, "NB1");
 
       var model = pipeline.Fit(trainingData);
       var predictions = model.Transform(trainingData);
@@ -130,6 +178,8 @@ namespace AxoLightModeller
         OnnxExportExtensions.ConvertToOnnx(mlContext.Model, model, exportData, stream);
         stream.Flush();
       }
+
+      ExportCalibrationLut(mlContext, trainingData, "calibration.lut");
     }
   }
 }